@@ -11,7 +11,16 @@ QCSAConsoleArguments::QCSAConsoleArguments(const QCoreApplication &application,
     , m_cursorLine(-1)
     , m_cursorColumn(-1)
     , m_logLevel(csa::QCSAConsole::getLogLevel())
-    , m_executeAndQuitFlag(false){
+    , m_executeAndQuitFlag(false)
+    , m_patchOutputFlag(false)
+    , m_extractIncludesFlag(false)
+    , m_translationUnitCacheFlag(false)
+    , m_profileFlag(false)
+    , m_precompiledHeaderDetectionFlag(false)
+    , m_unsavedFileDescriptor(0)
+    , m_timeBudget(0)
+    , m_jobs(0)
+    , m_batchJobs(1){
 
     m_headerSearchPatterns << "*.c" << "*.C" << "*.cxx" << "*.cpp" << "*.c++" << "*.cc" << "*.cp";
     m_sourceSearchPatterns << "*.h" << "*.H" << "*.hxx" << "*.hpp" << "*.h++" << "*.hh" << "*.hp";
@@ -69,6 +78,85 @@ void QCSAConsoleArguments::initialize(const QCoreApplication &app, const QString
     );
     m_commandLineParser->addOption(executeAndQuit);
 
+    QCommandLineOption patchOutput("patch",
+        QCoreApplication::translate("main", "Write saved edits to stdout as patches instead of modifying files.")
+    );
+    m_commandLineParser->addOption(patchOutput);
+
+    QCommandLineOption extractIncludes("extract-includes",
+        QCoreApplication::translate("main", "Build project headers from the translation units of the sources that "
+                                            "include them, instead of parsing each header separately.")
+    );
+    m_commandLineParser->addOption(extractIncludes);
+
+    QCommandLineOption translationUnitCache("cache",
+        QCoreApplication::translate("main", "Save parsed files to the cache directory, and load them back on the next "
+                                            "run if they haven't changed.")
+    );
+    m_commandLineParser->addOption(translationUnitCache);
+
+    QCommandLineOption precompiledHeader("pch",
+        QCoreApplication::translate("main", "Add <header> to the precompiled header shared by all parsed files. "
+                                            "Can be given multiple times."),
+        QCoreApplication::translate("main", "header")
+    );
+    m_commandLineParser->addOption(precompiledHeader);
+
+    QCommandLineOption precompiledHeaderDetection("pch-auto",
+        QCoreApplication::translate("main", "Add the library headers included by most of the parsed sources to the "
+                                            "precompiled header.")
+    );
+    m_commandLineParser->addOption(precompiledHeaderDetection);
+
+    QCommandLineOption unsavedFile("unsaved",
+        QCoreApplication::translate("main", "Read the contents of a file from stdin instead of disk. Multiple files "
+                                            "are read in order, each with its size in bytes, except for the last one."),
+        QCoreApplication::translate("main", "file[:size]")
+    );
+    m_commandLineParser->addOption(unsavedFile);
+
+    QCommandLineOption unsavedFileDescriptor("unsaved-fd",
+        QCoreApplication::translate("main", "File descriptor to read unsaved file contents from instead of stdin."),
+        QCoreApplication::translate("main", "fd")
+    );
+    m_commandLineParser->addOption(unsavedFileDescriptor);
+
+    QCommandLineOption timeBudget("time-budget",
+        QCoreApplication::translate("main", "Interrupt commands running longer than the given number of milliseconds, "
+                                            "discarding their unsaved changes."),
+        QCoreApplication::translate("main", "msec")
+    );
+    m_commandLineParser->addOption(timeBudget);
+
+    QCommandLineOption profile("profile",
+        QCoreApplication::translate("main", "Record the time each command spends in scripts, searches, saves, reparses "
+                                            "and file access, and the number of calls made into each slot. The profile "
+                                            "is printed at exit.")
+    );
+    m_commandLineParser->addOption(profile);
+
+    QCommandLineOption batch("batch",
+        QCoreApplication::translate("main", "Run the selected function once for each parsed file matching <files>, "
+                                            "then write all edits and quit. <files> is either a wildcard pattern or a "
+                                            "file listing one path per line."),
+        QCoreApplication::translate("main", "files")
+    );
+    m_commandLineParser->addOption(batch);
+
+    QCommandLineOption jobs("jobs",
+        QCoreApplication::translate("main", "Number of threads used by parallelMap()."),
+        QCoreApplication::translate("main", "n")
+    );
+    m_commandLineParser->addOption(jobs);
+
+    QCommandLineOption batchJobs("batch-jobs",
+        QCoreApplication::translate("main", "Number of threads running the batch. When <n> is greater than 1, the "
+                                            "selected function runs as a read only query, and files it tries to edit "
+                                            "are reported as failed."),
+        QCoreApplication::translate("main", "n")
+    );
+    m_commandLineParser->addOption(batchJobs);
+
     // Process arguments
     // -----------------
 
@@ -122,4 +210,60 @@ void QCSAConsoleArguments::initialize(const QCoreApplication &app, const QString
 
     m_projectDir          = m_commandLineParser->isSet(projectDir) ? m_commandLineParser->value(projectDir) : "";
     m_executeAndQuitFlag  = m_commandLineParser->isSet(executeAndQuit);
+    m_patchOutputFlag     = m_commandLineParser->isSet(patchOutput);
+    m_extractIncludesFlag = m_commandLineParser->isSet(extractIncludes);
+    m_translationUnitCacheFlag = m_commandLineParser->isSet(translationUnitCache);
+    m_profileFlag              = m_commandLineParser->isSet(profile);
+
+    m_precompiledHeaders             = m_commandLineParser->values(precompiledHeader);
+    m_precompiledHeaderDetectionFlag = m_commandLineParser->isSet(precompiledHeaderDetection);
+
+    QStringList unsavedValues = m_commandLineParser->values(unsavedFile);
+    for ( QStringList::iterator it = unsavedValues.begin(); it != unsavedValues.end(); ++it ){
+        int sizeSeparator = it->lastIndexOf(':');
+        bool sizeConvertOk = false;
+        int size = sizeSeparator != -1 ? it->mid(sizeSeparator + 1).toInt(&sizeConvertOk) : -1;
+
+        if ( sizeConvertOk ){
+            m_unsavedFiles.append(it->left(sizeSeparator));
+            m_unsavedFileSizes.append(size);
+        } else if ( it + 1 == unsavedValues.end() ){
+            m_unsavedFiles.append(*it);
+            m_unsavedFileSizes.append(-1);
+        } else {
+            m_commandLineParser->showHelp(4);
+        }
+    }
+
+    if ( m_commandLineParser->isSet(unsavedFileDescriptor) ){
+        bool fdConvertOk;
+        m_unsavedFileDescriptor = m_commandLineParser->value(unsavedFileDescriptor).toInt(&fdConvertOk);
+        if ( !fdConvertOk )
+            m_commandLineParser->showHelp(5);
+    }
+
+    if ( m_commandLineParser->isSet(timeBudget) ){
+        bool timeBudgetConvertOk;
+        m_timeBudget = m_commandLineParser->value(timeBudget).toInt(&timeBudgetConvertOk);
+        if ( !timeBudgetConvertOk || m_timeBudget < 0 )
+            m_commandLineParser->showHelp(6);
+    }
+
+    m_batch = m_commandLineParser->isSet(batch) ? m_commandLineParser->value(batch) : "";
+    if ( !m_batch.isEmpty() && !m_functionSet )
+        m_commandLineParser->showHelp(7);
+
+    if ( m_commandLineParser->isSet(jobs) ){
+        bool jobsConvertOk;
+        m_jobs = m_commandLineParser->value(jobs).toInt(&jobsConvertOk);
+        if ( !jobsConvertOk || m_jobs < 1 )
+            m_commandLineParser->showHelp(8);
+    }
+
+    if ( m_commandLineParser->isSet(batchJobs) ){
+        bool batchJobsConvertOk;
+        m_batchJobs = m_commandLineParser->value(batchJobs).toInt(&batchJobsConvertOk);
+        if ( !batchJobsConvertOk || m_batchJobs < 1 )
+            m_commandLineParser->showHelp(9);
+    }
 }
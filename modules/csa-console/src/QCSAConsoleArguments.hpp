@@ -28,6 +28,24 @@ public:
     int   logLevel() const;
 
     bool  isExecuteAndQuitSet() const;
+    bool  isPatchOutputSet() const;
+    bool  isExtractIncludesSet() const;
+    bool  isTranslationUnitCacheSet() const;
+    bool  isProfileSet() const;
+
+    const QStringList& precompiledHeaders() const;
+    bool  isPrecompiledHeaderDetectionSet() const;
+
+    const QStringList& unsavedFiles() const;
+    const QList<int>&  unsavedFileSizes() const;
+    int   unsavedFileDescriptor() const;
+
+    int   timeBudget() const;
+
+    bool  isBatchSet() const;
+    const QString& batch() const;
+    int   jobs() const;
+    int   batchJobs() const;
 
     QString projectDir() const;
 
@@ -58,6 +76,23 @@ private:
     int     m_logLevel;
 
     bool    m_executeAndQuitFlag;
+    bool    m_patchOutputFlag;
+    bool    m_extractIncludesFlag;
+    bool    m_translationUnitCacheFlag;
+    bool    m_profileFlag;
+
+    QStringList m_precompiledHeaders;
+    bool        m_precompiledHeaderDetectionFlag;
+
+    QStringList m_unsavedFiles;
+    QList<int>  m_unsavedFileSizes;
+    int         m_unsavedFileDescriptor;
+
+    int         m_timeBudget;
+
+    QString     m_batch;
+    int         m_jobs;
+    int         m_batchJobs;
 };
 
 inline const QStringList& QCSAConsoleArguments::files() const{
@@ -108,6 +143,62 @@ inline bool QCSAConsoleArguments::isExecuteAndQuitSet() const{
     return m_executeAndQuitFlag;
 }
 
+inline bool QCSAConsoleArguments::isPatchOutputSet() const{
+    return m_patchOutputFlag;
+}
+
+inline bool QCSAConsoleArguments::isExtractIncludesSet() const{
+    return m_extractIncludesFlag;
+}
+
+inline bool QCSAConsoleArguments::isTranslationUnitCacheSet() const{
+    return m_translationUnitCacheFlag;
+}
+
+inline bool QCSAConsoleArguments::isProfileSet() const{
+    return m_profileFlag;
+}
+
+inline const QStringList& QCSAConsoleArguments::precompiledHeaders() const{
+    return m_precompiledHeaders;
+}
+
+inline bool QCSAConsoleArguments::isPrecompiledHeaderDetectionSet() const{
+    return m_precompiledHeaderDetectionFlag;
+}
+
+inline const QStringList& QCSAConsoleArguments::unsavedFiles() const{
+    return m_unsavedFiles;
+}
+
+inline const QList<int>& QCSAConsoleArguments::unsavedFileSizes() const{
+    return m_unsavedFileSizes;
+}
+
+inline int QCSAConsoleArguments::unsavedFileDescriptor() const{
+    return m_unsavedFileDescriptor;
+}
+
+inline int QCSAConsoleArguments::timeBudget() const{
+    return m_timeBudget;
+}
+
+inline bool QCSAConsoleArguments::isBatchSet() const{
+    return !m_batch.isEmpty();
+}
+
+inline const QString& QCSAConsoleArguments::batch() const{
+    return m_batch;
+}
+
+inline int QCSAConsoleArguments::jobs() const{
+    return m_jobs;
+}
+
+inline int QCSAConsoleArguments::batchJobs() const{
+    return m_batchJobs;
+}
+
 inline QString QCSAConsoleArguments::projectDir() const{
     return m_projectDir;
 }
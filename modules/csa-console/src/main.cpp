@@ -1,9 +1,14 @@
 #include <QQmlContext>
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QRegExp>
 #include <QQmlEngine>
 #include <qqml.h>
 
 #include "QCodeBase.hpp"
 #include "QCSAConsole.hpp"
+#include "QCSAProfiler.hpp"
 #include "QCSAPluginLoader.hpp"
 #include "QCSAConsoleArguments.hpp"
 #include "QCSAInputHandler.hpp"
@@ -12,12 +17,73 @@
 #include "QAnnotatedToken.hpp"
 #include "QCSAPluginLoader.hpp"
 #include "QCSACompletionSet.hpp"
+#include "QCSANodeCollection.hpp"
 #include "QASTNode.hpp"
 #include "QASTFile.hpp"
 
 using namespace csa;
 using namespace csa::ast;
 
+bool readUnsavedContents(const QCSAConsoleArguments& arguments, QHash<QString, QByteArray>& contents){
+    if ( arguments.unsavedFiles().isEmpty() )
+        return true;
+
+    QFile input;
+    if ( !input.open(arguments.unsavedFileDescriptor(), QIODevice::ReadOnly) ){
+        QCSAConsole::logError("Cannot open file descriptor for unsaved file contents: " + input.errorString());
+        return false;
+    }
+
+    return QCodeBase::readUnsavedContents(
+        &input, arguments.unsavedFiles(), arguments.unsavedFileSizes(), contents
+    );
+}
+
+// Files matching the batch argument, which is either a wildcard pattern matched against the parsed files, or a file
+// listing one path per line. Listed files that weren't parsed yet are parsed here.
+QStringList readBatchFiles(const QString& batch, QCodeBase& codeBase){
+    const QList<QASTFile*>& astFiles = codeBase.astFiles();
+
+    QHash<QString, QString> identifiers;
+    for ( QList<QASTFile*>::const_iterator it = astFiles.begin(); it != astFiles.end(); ++it )
+        identifiers[QFileInfo((*it)->identifier()).absoluteFilePath()] = (*it)->identifier();
+
+    QStringList files;
+    if ( batch.contains(QRegExp("[*?\\[]")) ){
+        QRegExp pattern(batch, Qt::CaseSensitive, QRegExp::Wildcard);
+        for ( QList<QASTFile*>::const_iterator it = astFiles.begin(); it != astFiles.end(); ++it ){
+            QString identifier = (*it)->identifier();
+            if ( pattern.exactMatch(identifier) || pattern.exactMatch(QDir::current().relativeFilePath(identifier)) )
+                files.append(identifier);
+        }
+        if ( files.isEmpty() )
+            QCSAConsole::logError("No parsed files match the batch pattern: " + batch);
+        return files;
+    }
+
+    QFile input(batch);
+    if ( !input.open(QIODevice::ReadOnly | QIODevice::Text) ){
+        QCSAConsole::logError("Cannot open batch file list \'" + batch + "\': " + input.errorString());
+        return files;
+    }
+
+    while ( !input.atEnd() ){
+        QString path = QString::fromUtf8(input.readLine()).trimmed();
+        if ( path.isEmpty() )
+            continue;
+
+        QHash<QString, QString>::const_iterator identifierIt = identifiers.find(QFileInfo(path).absoluteFilePath());
+        if ( identifierIt != identifiers.end() ){
+            files.append(identifierIt.value());
+        } else {
+            QASTFile* file = codeBase.parseFile(path);
+            if ( file )
+                files.append(file->identifier());
+        }
+    }
+    return files;
+}
+
 int main(int argc, char* argv[]){
 
     // Initialize command line arguments
@@ -54,7 +120,40 @@ int main(int argc, char* argv[]){
     // ---------------
 
     const char* args[] = {"-c", "-x", "c++"};
-    QCodeBase codeBase(args, 3, commandLineArguments.files(), commandLineArguments.projectDir(), 0);
+    QHash<QString, QByteArray> unsavedContents;
+    if ( !readUnsavedContents(commandLineArguments, unsavedContents) )
+        return 4;
+
+    QStringList precompiledHeaders = commandLineArguments.precompiledHeaders();
+    if ( commandLineArguments.isPrecompiledHeaderDetectionSet() ){
+        precompiledHeaders << QCodeBase::detectCommonHeaders(
+            commandLineArguments.files(), commandLineArguments.projectDir()
+        );
+        precompiledHeaders.removeDuplicates();
+    }
+
+    QCodeBase::ParseOptions parseOptions = QCodeBase::DefaultParseOptions;
+    if ( commandLineArguments.isExtractIncludesSet() )
+        parseOptions |= QCodeBase::SharedTranslationUnits;
+    if ( commandLineArguments.isTranslationUnitCacheSet() )
+        parseOptions |= QCodeBase::CachedTranslationUnits;
+
+    QCodeBase codeBase(
+        args, 3,
+        commandLineArguments.files(),
+        unsavedContents,
+        parseOptions,
+        precompiledHeaders,
+        commandLineArguments.projectDir(),
+        0
+    );
+    codeBase.setDeferredSave(true);
+
+    QFile patchOutput;
+    if ( commandLineArguments.isPatchOutputSet() ){
+        patchOutput.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered);
+        codeBase.setEditOutput(&patchOutput);
+    }
 
     if ( commandLineArguments.isCursorOffsetSet() ){
         codeBase.propagateUserCursor(
@@ -98,29 +197,60 @@ int main(int argc, char* argv[]){
     qmlRegisterUncreatableType<csa::ast::QASTNode>(
         "CSA", 1, 0, "ASTNode", "ASTNode is available only as a property.");
 
+    qmlRegisterUncreatableType<csa::QCSANodeCollection>(
+        "CSA", 1, 0, "NativeNodeCollection", "Node collections are created through the NodeCollection type.");
+
     QCSACompletionSet completionSet;
 
     QCSAPluginLoader scriptEngine(new QJSEngine);
-    scriptEngine.setContextObject("codeBase", &codeBase);
+    scriptEngine.setCodeBase(&codeBase);
     scriptEngine.setContextObject("plugins",  &completionSet);
     scriptEngine.loadNodeCollection();
     scriptEngine.loadNodesFunction();
     scriptEngine.loadFileFunctions();
 
-    int loaderError = scriptEngine.loadPlugins(QCoreApplication::applicationDirPath() + "/plugins");
+    QString pluginPath = QCoreApplication::applicationDirPath() + "/plugins";
+    scriptEngine.loadWorkerPool(pluginPath, commandLineArguments.jobs() > 0 ? commandLineArguments.jobs() : -1);
+    scriptEngine.setTimeBudget(commandLineArguments.timeBudget());
+
+    if ( commandLineArguments.isProfileSet() )
+        QCSAProfiler::instance().setEnabled(true);
+
+    // A single command only needs the plugins it refers to, while the console loads all of them for completion
+    int loaderError = commandLineArguments.isExecuteAndQuitSet() || commandLineArguments.isBatchSet() ?
+        scriptEngine.registerPlugins(pluginPath) :
+        scriptEngine.loadPlugins(pluginPath);
     if ( loaderError != 0 )
         return loaderError;
 
-    if( commandLineArguments.isExecuteAndQuitSet() ){
+    int exitCode = 0;
+    if ( commandLineArguments.isBatchSet() ){
+        // Each file reports its result as soon as its command finishes, while edits are written once at the end
+        QStringList batchFiles = readBatchFiles(commandLineArguments.batch(), codeBase);
+        int failures = scriptEngine.executeBatch(
+            commandLineArguments.selectedFunction(), batchFiles, commandLineArguments.batchJobs()
+        );
+        QCSAConsole::log(
+            QCSAConsole::General,
+            "Batch finished: " + QString::number(batchFiles.size() - failures) + " of " +
+            QString::number(batchFiles.size()) + " files succeeded."
+        );
+        exitCode = batchFiles.isEmpty() || failures > 0 ? 1 : 0;
+    } else if( commandLineArguments.isExecuteAndQuitSet() ){
         QJSValue result;
         if ( scriptEngine.execute(commandLineArguments.selectedFunction(), result) ){
             if ( !result.isUndefined() )
                 QCSAConsole::log(QCSAConsole::General, result.toString());
-            return 0;
+        } else {
+            exitCode = 1;
         }
-        return 1;
+    } else {
+        QCSAInputHandler::getInstance().initPluginHandlers(&scriptEngine, &completionSet);
+        exitCode = QCSAInputHandler::getInstance().inputLoop();
     }
 
-    QCSAInputHandler::getInstance().initPluginHandlers(&scriptEngine, &completionSet);
-    return QCSAInputHandler::getInstance().inputLoop();
+    if ( commandLineArguments.isProfileSet() )
+        QCSAConsole::log(QCSAConsole::General, QCSAProfiler::instance().toString());
+
+    return exitCode;
 }
@@ -30,6 +30,7 @@ QCSAFileViewArguments::QCSAFileViewArguments(
     , m_cursorLine(-1)
     , m_cursorColumn(-1)
     , m_logLevel(csa::QCSAConsole::getLogLevel())
+    , m_timeBudget(0)
 {
     m_headerSearchPatterns << "*.c" << "*.C" << "*.cxx" << "*.cpp" << "*.c++" << "*.cc" << "*.cp";
     m_sourceSearchPatterns << "*.h" << "*.H" << "*.hxx" << "*.hpp" << "*.h++" << "*.hh" << "*.hp";
@@ -82,6 +83,13 @@ void QCSAFileViewArguments::initialize(const QGuiApplication& app, const QString
     );
     m_commandLineParser->addOption(logLevel);
 
+    QCommandLineOption timeBudget("time-budget",
+        QCoreApplication::translate("main", "Interrupt commands running longer than the given number of milliseconds, "
+                                            "discarding their unsaved changes."),
+        QCoreApplication::translate("main", "msec")
+    );
+    m_commandLineParser->addOption(timeBudget);
+
     // Process arguments
     // -----------------
 
@@ -133,5 +141,12 @@ void QCSAFileViewArguments::initialize(const QGuiApplication& app, const QString
 
     m_projectDir = m_commandLineParser->isSet(projectDir) ? m_commandLineParser->value(projectDir) : "";
     m_logLevel   = m_commandLineParser->isSet(logLevel) ? m_commandLineParser->value(logLevel).toInt() : m_logLevel;
+
+    if ( m_commandLineParser->isSet(timeBudget) ){
+        bool timeBudgetConvertOk;
+        m_timeBudget = m_commandLineParser->value(timeBudget).toInt(&timeBudgetConvertOk);
+        if ( !timeBudgetConvertOk || m_timeBudget < 0 )
+            m_commandLineParser->showHelp(4);
+    }
 }
 
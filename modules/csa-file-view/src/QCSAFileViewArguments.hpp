@@ -46,6 +46,8 @@ public:
 
     const QString& projectDir() const;
 
+    int   timeBudget() const;
+
 private:
     QCSAFileViewArguments(const QCSAFileViewArguments& other);
     QCSAFileViewArguments& operator =(const QCSAFileViewArguments& other);
@@ -71,6 +73,8 @@ private:
     int     m_cursorColumn;
 
     int     m_logLevel;
+
+    int     m_timeBudget;
 };
 
 inline const QStringList& QCSAFileViewArguments::files() const{
@@ -121,4 +125,8 @@ inline int QCSAFileViewArguments::logLevel() const{
     return m_logLevel;
 }
 
+inline int QCSAFileViewArguments::timeBudget() const{
+    return m_timeBudget;
+}
+
 #endif // QCSAFILEVIEWARGUMENTS_HPP
@@ -23,6 +23,7 @@
 #include "QCSAConsole.hpp"
 #include "QCSAPluginLoader.hpp"
 #include "QCSACompletionSet.hpp"
+#include "QCSANodeCollection.hpp"
 #include "QCSACompletionModel.hpp"
 
 #include "QSourceLocation.hpp"
@@ -76,6 +77,7 @@ int main(int argc, char *argv[]){
 
     const char* args[] = {"-c", "-x", "c++"};
     QCodeBase codeBase(args, 3, commandLineArguments.files(), commandLineArguments.projectDir(), 0);
+    codeBase.setDeferredSave(true);
 
     if ( commandLineArguments.isCursorOffsetSet() ){
         codeBase.propagateUserCursor(
@@ -140,16 +142,21 @@ int main(int argc, char *argv[]){
     qmlRegisterUncreatableType<csa::ast::QASTNode>(
         "CSA", 1, 0, "ASTNode", "ASTNode is available only as a property.");
 
+    qmlRegisterUncreatableType<csa::QCSANodeCollection>(
+        "CSA", 1, 0, "NativeNodeCollection", "Node collections are created through the NodeCollection type.");
+
     QCSACompletionSet set;
     QCSACompletionModel pluginCollection(&set);
     set.initDefaultCompletions();
 
     QCSAPluginLoader scriptEngine(new QJSEngine);
-    scriptEngine.setContextObject("codeBase", &codeBase);
+    scriptEngine.setCodeBase(&codeBase);
     scriptEngine.setContextObject("plugins",  &pluginCollection);
     scriptEngine.loadNodeCollection();
     scriptEngine.loadNodesFunction();
     scriptEngine.loadFileFunctions();
+    scriptEngine.loadWorkerPool(QGuiApplication::applicationDirPath() + "/plugins");
+    scriptEngine.setTimeBudget(commandLineArguments.timeBudget());
 
     QQmlApplicationEngine engine;
     engine.rootContext()->setContextProperty("syntaxTreeModel",  astTreeModel);
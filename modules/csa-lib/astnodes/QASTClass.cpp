@@ -73,15 +73,4 @@ QASTClass::QASTClass(
 QASTClass::~QASTClass(){
 }
 
-QASTNode *QASTClass::propagateUserCursor(const QSourceLocation &location){
-    QASTNode* base = this;
-    if ( rangeStartLocation()->offset() <= location.offset() && rangeEndLocation()->offset() >= location.offset() ){
-        //m_offsets[QASTClass::CURSOR] = new SourceLocation(location);
-        QASTNode* result = QASTNode::propagateUserCursor(location);
-        if ( result != 0 )
-            base = result;
-    }
-    return base;
-}
-
 }}// namespace
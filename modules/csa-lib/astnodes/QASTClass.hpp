@@ -35,8 +35,6 @@ public:
 
     QString description() const;
 
-    virtual QASTNode* propagateUserCursor(const QSourceLocation &location);
-
     virtual QSourceLocation* bodyStartLocation();
     virtual QSourceLocation* bodyEndLocation();
 
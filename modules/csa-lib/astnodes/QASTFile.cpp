@@ -21,49 +21,41 @@
 #include "QTokenClassifier.hpp"
 #include "QAnnotatedTokenSet.hpp"
 #include "QCSAConsole.hpp"
+#include "QCSAWorkerPool.hpp"
+#include "QPieceTable.hpp"
 
 #include <QFile>
+#include <QSaveFile>
 #include <QFileInfo>
-#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QCryptographicHash>
+#include <QThread>
 
 #include <QDebug>
 
 namespace csa{ namespace ast{
 
-// QInsertionElementPrivate
-// ------------------------
+// QASTFile::FileStamp Definitions
+// -------------------------------
 
-class QModifierElementPrivate{
-
-public:
-    enum Type{
-        Insertion,
-        Erasion
-    };
-
-public:
-    QModifierElementPrivate(
-            const QString& pData,
-            const QSourceLocation& pLocation)
-        : type(Insertion), data(pData), location(pLocation), location2(pLocation){}
-
-    QModifierElementPrivate(const QSourceLocation& pLocation1, const QSourceLocation& pLocation2)
-        : type(Erasion), data(""), location(pLocation1), location2(pLocation2){}
-
-    Type    type;
-    QString data;
-    QSourceLocation location;
-    QSourceLocation location2;
-
-private:
-    QModifierElementPrivate();
-};
-
-bool offsetCompare(QModifierElementPrivate* e1, QModifierElementPrivate* e2){
-    if ( e1->location.filePath() == e2->location.filePath() )
-        return (e1->location.offset() < e2->location.offset());
+QASTFile::FileStamp::FileStamp(const QString& pPath)
+    : path(pPath)
+    , size(-1)
+{
+    if ( !path.isEmpty() ){
+        QFileInfo info(path);
+        lastModified = info.lastModified();
+        size         = info.exists() ? info.size() : -1;
+    }
+}
 
-    return (e1->location.filePath() < e2->location.filePath());
+bool QASTFile::FileStamp::hasChanged() const{
+    QFileInfo info(path);
+    if ( !info.exists() )
+        return size != -1;
+    return info.size() != size || info.lastModified() != lastModified;
 }
 
 // QASTFile Definitions
@@ -77,86 +69,181 @@ QASTFile::QASTFile(QAnnotatedTokenSet* tokenSet, const QString& file, QSourceLoc
           new QSourceLocation(file, 0, 0, 0),
           endOfFile,
           0)
+    , m_pieceTable(new QPieceTable)
+    , m_hasUnsavedContent(false)
 {
     setIdentifier(file);
 }
 
 QASTFile::~QASTFile(){
-    clearModifiers();
+    delete m_pieceTable;
 }
 
 bool QASTFile::hasModifiers(){
-    return m_modifiers.size() > 0;
+    return m_pieceTable->isModified();
 }
 
 void QASTFile::clearModifiers(){
-    for ( QList<QModifierElementPrivate*>::iterator it = m_modifiers.begin(); it != m_modifiers.end(); ++it ){
-        delete *it;
-    }
-    m_modifiers.clear();
+    m_pieceTable->reset(m_content);
 }
 
-void QASTFile::save(){
+bool QASTFile::save(){
+    QCSAProfiler::PhaseScope profilerPhase(QCSAProfiler::FileIO);
     if ( hasModifiers() ){
-        std::sort(m_modifiers.begin(), m_modifiers.end(), offsetCompare);
-
         QString filePath = identifier();
-        QFile file(filePath);
-        if ( !file.open(QIODevice::ReadOnly) ){
-            QCSAConsole::logError("Cannot open file \'" + filePath + "\' for reading.");
-            return;
-        }
-
-        QString fileData = QTextStream(&file).readAll();
-        file.close();
 
-        if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate ) ){
+        // Unchanged spans are copied from the loaded buffer into a temporary file, which then replaces the original
+        QSaveFile file(filePath);
+        if ( !file.open(QIODevice::WriteOnly) ){
             QCSAConsole::logError("Cannot open file \'" + filePath + "\' for writing.");
-            return;
+            return false;
+        }
+
+        if ( !m_pieceTable->write(&file) ){
+            QCSAConsole::logError("Failed to write file \'" + filePath + "\': " + file.errorString());
+            file.cancelWriting();
+            return false;
         }
 
-        QTextStream writeStream(&file);
-        int startCut, endCut = 0;
-        int insertions = 0, deletions = 0;
-
-        for ( QList<QModifierElementPrivate*>::iterator it = m_modifiers.begin(); it != m_modifiers.end(); ++it ){
-            QModifierElementPrivate* el = *it;
-
-            if ( el->type == QModifierElementPrivate::Insertion ){
-                startCut = endCut;
-                endCut   = el->location.offset();
-                writeStream << fileData.mid(startCut, endCut - startCut) << el->data;
-                ++insertions;
-            } else {
-                startCut = endCut;
-                endCut   = el->location.offset();
-                writeStream << fileData.mid(startCut, endCut - startCut);
-                endCut   = el->location2.offset();
-                ++deletions;
-            }
+        if ( !file.commit() ){
+            QCSAConsole::logError("Failed to replace file \'" + filePath + "\': " + file.errorString());
+            return false;
         }
-        writeStream << fileData.mid(endCut);
+        m_hasUnsavedContent = false;
 
         QCSAConsole::log(QCSAConsole::Info1,
-            "Total modifications: " + QString::number(insertions) + " insertions and " + QString::number(deletions) +
-            " in file \'" + identifier() +  "\'"
+            "Total modifications: " + QString::number(m_pieceTable->totalInsertions()) + " insertions and " +
+            QString::number(m_pieceTable->totalErasures()) + " in file \'" + identifier() +  "\'"
         );
 
         clearModifiers();
     }
+    return true;
+}
+
+bool QASTFile::saveEdits(QIODevice* output){
+    QCSAProfiler::PhaseScope profilerPhase(QCSAProfiler::FileIO);
+    if ( !hasModifiers() )
+        return true;
+
+    QJsonArray edits;
+    QPieceTable::EditList pieceEdits = m_pieceTable->edits();
+    for ( QPieceTable::EditList::const_iterator it = pieceEdits.begin(); it != pieceEdits.end(); ++it ){
+        QJsonObject edit;
+        edit["from"] = static_cast<int>(it->from);
+        edit["to"]   = static_cast<int>(it->to);
+        edit["text"] = QString::fromUtf8(it->replacement);
+        edits.append(edit);
+    }
+
+    QJsonObject patch;
+    patch["file"]  = identifier();
+    patch["edits"] = edits;
+
+    QByteArray patchData = QJsonDocument(patch).toJson(QJsonDocument::Compact) + "\n";
+    if ( output->write(patchData) != patchData.size() ){
+        QCSAConsole::logError("Failed to write edits for file \'" + identifier() + "\': " + output->errorString());
+        return false;
+    }
+
+    // The file on disk is left untouched, so the edits are kept as unsaved content for further queries
+    m_content = m_pieceTable->readAll();
+    m_decodedContent = QString();
+    m_hasUnsavedContent = true;
+    clearModifiers();
+
+    return true;
 }
 
 void QASTFile::reparseSize(){
     rangeEndLocation()->assign( createSourceLocation(
         identifier(),
-        QTokenClassifier::getFileSize(identifier().toStdString().c_str()),
+        static_cast<unsigned int>(m_content.size()),
         tokenSet()->translationUnit()
     ));
 }
 
+bool QASTFile::reloadContent(){
+    QCSAProfiler::PhaseScope profilerPhase(QCSAProfiler::FileIO);
+    if ( m_hasUnsavedContent ){
+        m_pieceTable->reset(m_content);
+        return true;
+    }
+
+    m_decodedContent = QString();
+
+    // Stamp is taken before reading, so a write during the read shows up as a change on the next check
+    m_stamp = FileStamp(identifier());
+
+    QFile file(identifier());
+    if ( !file.open(QIODevice::ReadOnly) ){
+        QCSAConsole::logError("Cannot open file \'" + identifier() + "\' for reading.");
+        m_content.clear();
+        m_pieceTable->reset(m_content);
+        return false;
+    }
+
+    m_content     = file.readAll();
+    m_contentHash = QCryptographicHash::hash(m_content, QCryptographicHash::Md5);
+    m_pieceTable->reset(m_content);
+    return true;
+}
+
+bool QASTFile::isStale(){
+    for ( QList<FileStamp>::const_iterator it = m_includedFiles.begin(); it != m_includedFiles.end(); ++it ){
+        if ( it->hasChanged() )
+            return true;
+    }
+
+    if ( m_hasUnsavedContent || !m_stamp.hasChanged() )
+        return false;
+
+    // The file was touched, compare contents before reporting a change
+    FileStamp stamp(identifier());
+    QFile file(identifier());
+    if ( !file.open(QIODevice::ReadOnly) )
+        return true;
+    if ( QCryptographicHash::hash(file.readAll(), QCryptographicHash::Md5) != m_contentHash )
+        return true;
+
+    m_stamp = stamp;
+    return false;
+}
+
+void QASTFile::setIncludedFiles(const QStringList& files){
+    m_includedFiles.clear();
+    for ( QStringList::const_iterator it = files.begin(); it != files.end(); ++it )
+        m_includedFiles.append(FileStamp(*it));
+}
+
+void QASTFile::setUnsavedContent(const QByteArray& content){
+    m_content = content;
+    m_decodedContent = QString();
+    m_hasUnsavedContent = true;
+    m_pieceTable->reset(m_content);
+}
+
+const QString& QASTFile::decodedContent() const{
+    if ( m_decodedContent.isNull() )
+        m_decodedContent = QString::fromUtf8(m_content);
+    return m_decodedContent;
+}
+
+void QASTFile::prepareConcurrentReads() const{
+    // Both caches are otherwise filled by the first read, which may happen on several threads at once
+    decodedContent();
+    m_pieceTable->buildPositionIndex();
+}
+
 bool QASTFile::insert(const QString& value, QSourceLocation* location){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( QThread::currentThread() != thread() ){
+        QCSAWorkerPool::rejectOperation("Cannot insert :\'" +  value + "'. Files are read only for workers.");
+        return false;
+    }
+
     if ( location->offset() <= size() && location->filePath() == identifier() ){
-         m_modifiers.append(new QModifierElementPrivate(value, *location));
+        m_pieceTable->insert(location->offset(), value.toUtf8());
         return true;
     } else {
         QCSAConsole::logError("Cannot insert :\'" +  value + "'. Incompatible file location.");
@@ -165,13 +252,20 @@ bool QASTFile::insert(const QString& value, QSourceLocation* location){
 }
 
 bool QASTFile::erase(QSourceLocation* from, QSourceLocation* to){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( QThread::currentThread() != thread() ){
+        QCSAWorkerPool::rejectOperation("Cannot erase between positions: " + from->toString() + " and " +
+            to->toString() + ". Files are read only for workers.");
+        return false;
+    }
+
     if ( from->offset() <= size() &&
          to->offset() <= size() &&
          from->offset() <= to->offset() &&
          from->filePath() == identifier() &&
          to->filePath() == identifier() )
     {
-        m_modifiers.append(new QModifierElementPrivate(*from, *to));
+        m_pieceTable->erase(from->offset(), to->offset());
         return true;
     } else {
         QCSAConsole::logError(
@@ -182,33 +276,34 @@ bool QASTFile::erase(QSourceLocation* from, QSourceLocation* to){
 }
 
 QString QASTFile::readAll(){
-    QFile file(identifier());
-    if ( !file.open(QIODevice::ReadOnly) ){
-        QCSAConsole::logError("Cannot open file \'" + identifier() + "\' for reading.");
-        return "";
-    }
-
-    return QTextStream(&file).readAll();
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( m_pieceTable->isModified() )
+        return QString::fromUtf8(m_pieceTable->readAll());
+    return decodedContent();
 }
 
 QString QASTFile::read(QSourceLocation* start, QSourceLocation* end) const{
-    QFile file(identifier());
-    if ( !file.open(QIODevice::ReadOnly) ){
-        QCSAConsole::logError("Cannot open file \'" + identifier() + "\' for reading.");
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( start->offset() > end->offset() )
         return "";
-    }
+    if ( m_pieceTable->isModified() )
+        return QString::fromUtf8(m_pieceTable->read(start->offset(), end->offset()));
 
-    QTextStream fileStream(&file);
-    fileStream.seek(start->offset());
+    unsigned int contentSize = static_cast<unsigned int>(m_content.size());
+    if ( start->offset() > contentSize )
+        return "";
 
-    return fileStream.read(end->offset() - start->offset());
+    unsigned int endOffset = end->offset() > contentSize ? contentSize : end->offset();
+    return QString::fromUtf8(m_content.constData() + start->offset(), endOffset - start->offset());
 }
 
 unsigned int QASTFile::size(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return rangeEndLocation()->offset() + 1;
 }
 
 QSourceLocation* QASTFile::createLocation(unsigned int lineOrOffset, unsigned int column){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     CXFile clangFile = clang_getFile(tokenSet()->translationUnit(), identifier().toLocal8Bit().constData());
     return new QSourceLocation(
         createSourceLocation(
@@ -217,18 +312,43 @@ QSourceLocation* QASTFile::createLocation(unsigned int lineOrOffset, unsigned in
     );
 }
 
+QSourceLocation* QASTFile::createModifiedLocation(unsigned int modifiedOffset){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    return createLocation(m_pieceTable->originalOffset(modifiedOffset));
+}
+
+unsigned int QASTFile::modifiedOffset(QSourceLocation* location){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( location->filePath() != identifier() ){
+        QCSAConsole::logError("Cannot map location " + location->toString() + ". Incompatible file location.");
+        return 0;
+    }
+    return m_pieceTable->modifiedOffset(location->offset());
+}
+
 QString QASTFile::fileName(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return QFileInfo(identifier()).fileName();
 }
 
 QString QASTFile::fileNameWithouExtension(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return QFileInfo(identifier()).baseName();
 }
 
 QString QASTFile::extension(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return QFileInfo(identifier()).suffix();
 }
 
+QStringList QASTFile::includedFiles() const{
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QStringList files;
+    for ( QList<FileStamp>::const_iterator it = m_includedFiles.begin(); it != m_includedFiles.end(); ++it )
+        files.append(it->path);
+    return files;
+}
+
 QString QASTFile::text(QSourceLocation *from, QSourceLocation *to){
     return read(from, to);
 }
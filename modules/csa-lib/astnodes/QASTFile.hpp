@@ -20,10 +20,17 @@
 
 #include "QCSAGlobal.hpp"
 #include "QASTNode.hpp"
+#include <QByteArray>
+#include <QDateTime>
+#include <QStringList>
 
-namespace csa{ namespace ast{
+class QIODevice;
 
-class QModifierElementPrivate;
+namespace csa{
+
+class QPieceTable;
+
+namespace ast{
 
 class Q_CSA_EXPORT QASTFile : public QASTNode{
 
@@ -35,11 +42,22 @@ public:
 
     bool hasModifiers();
     void clearModifiers();
-    void save();
+    bool save();
+    bool saveEdits(QIODevice* output);
     QString description() const;
 
     void reparseSize();
 
+    bool reloadContent();
+    const QByteArray& content() const;
+    bool hasUnsavedContent() const;
+    void setUnsavedContent(const QByteArray& content);
+
+    bool isStale();
+    void setIncludedFiles(const QStringList& files);
+
+    void prepareConcurrentReads() const;
+
 public slots:
     bool insert(const QString& value, csa::QSourceLocation* location);
     bool erase(csa::QSourceLocation* from, csa::QSourceLocation* to);
@@ -48,23 +66,55 @@ public slots:
     unsigned int size();
 
     csa::QSourceLocation* createLocation(unsigned int lineOrOffset, unsigned int column = 0);
+    csa::QSourceLocation* createModifiedLocation(unsigned int modifiedOffset);
+    unsigned int modifiedOffset(csa::QSourceLocation* location);
 
     QString fileName();
     QString fileNameWithouExtension();
     QString extension();
+    QStringList includedFiles() const;
 
 protected:
     virtual QString text(QSourceLocation *from, QSourceLocation *to);
 
 private:
-    QList<QModifierElementPrivate*> m_modifiers;
+    // Modification time and size of a file on disk at the time it was last read
+    class FileStamp{
+    public:
+        FileStamp(const QString& pPath = "");
+
+        bool hasChanged() const;
+
+        QString   path;
+        QDateTime lastModified;
+        qint64    size;
+    };
 
+    const QString& decodedContent() const;
+
+    QPieceTable*    m_pieceTable;
+
+    QByteArray      m_content;
+    mutable QString m_decodedContent;
+    bool            m_hasUnsavedContent;
+
+    FileStamp        m_stamp;
+    QByteArray       m_contentHash;
+    QList<FileStamp> m_includedFiles;
 };
 
 inline QString QASTFile::description() const{
     return QString("file \"") + identifier() + "\"";
 }
 
+inline const QByteArray& QASTFile::content() const{
+    return m_content;
+}
+
+inline bool QASTFile::hasUnsavedContent() const{
+    return m_hasUnsavedContent;
+}
+
 }}//namespace csa, ast
 
 Q_DECLARE_METATYPE(csa::ast::QASTFile*)
@@ -21,9 +21,57 @@
 #include "QAnnotatedTokenSet.hpp"
 
 #include "QASTSearch.hpp"
+#include "QCSAConsole.hpp"
+#include "QCSAWorkerPool.hpp"
+
+#include <QJSEngine>
+#include <QQmlEngine>
+#include <QThread>
+#include <algorithm>
 
 namespace csa{ namespace ast{
 
+// Range Helpers
+// -------------
+
+namespace{
+
+// Children are kept sorted by their range start, which enables binary search for the children starting before an
+// offset. Siblings may overlap, such as a typedef and the struct declared within it, so their range ends do not follow
+// the same order and are checked one by one. Children without a range are kept in front of the others, where the
+// lookups skip them.
+
+inline bool hasRange(QASTNode* node){
+    return node->rangeStartLocation() && node->rangeEndLocation();
+}
+
+inline unsigned int rangeStartOffset(QASTNode* node){
+    return hasRange(node) ? node->rangeStartLocation()->offset() : 0;
+}
+
+inline unsigned int rangeEndOffset(QASTNode* node){
+    return hasRange(node) ? node->rangeEndLocation()->offset() : 0;
+}
+
+bool offsetBeforeNode(unsigned int offset, QASTNode* node){
+    return hasRange(node) && offset < rangeStartOffset(node);
+}
+
+// Script Helpers
+// --------------
+
+// Engine of the script calling into the node. Workers call with their own engine, while the one the node is exposed
+// to belongs to the thread owning the code base.
+QJSEngine* callingEngine(QObject* object){
+    QJSEngine* engine = QCSAWorkerPool::threadEngine();
+    return engine ? engine : qjsEngine(object);
+}
+
+}// namespace
+
+// QASTNode Definitions
+// --------------------
+
 int QASTNode::dumpIndentation = 1;
 
 QASTNode::QASTNode(
@@ -68,40 +116,47 @@ const QASTNode*QASTNode::astParent() const{
 
 
 QString QASTNode::breadcrumbs() const{
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     if ( astParent() )
         return astParent()->breadcrumbs() + "/" + identifier().replace('/', "\\/");
     return identifier().replace('/', "\\/");
 }
 
 QString QASTNode::description() const{
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return identifier();
 }
 
 QString QASTNode::prop(const QString &) const{
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return "";
 }
 
 QString QASTNode::text(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return text(rangeStartLocation(), rangeEndLocation());
 }
 
 QList<QObject*> QASTNode::children(const QString& type){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     if ( type == "" )
-        return castNodeListToObjectList(m_children);
+        return retainScriptValues(castNodeListToObjectList(m_children));
 
     QList<QObject*> foundChildren;
     for ( ConstIterator it = m_children.begin(); it != m_children.end(); ++it ){
         if ( (*it)->typeName() == type )
             foundChildren.append(*it);
     }
-    return foundChildren;
+    return retainScriptValues(foundChildren);
 }
 
 QList<QObject*> QASTNode::arguments() const{
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return QList<QObject*>();
 }
 
 QList<QObject*> QASTNode::associatedTokens(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     if ( m_tokenSet ){
         QList<QObject*> tokens;
         for ( QList<QAnnotatedToken*>::const_iterator it = m_tokenSet->tokenList().begin();
@@ -117,27 +172,33 @@ QList<QObject*> QASTNode::associatedTokens(){
 }
 
 QASTNode* QASTNode::astParent(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     QASTNode* p = qobject_cast<QASTNode*>(parent());
-    return p;
+    return retainScriptValue(p);
 }
 
 void QASTNode::append(const QString& value){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     insert(value, bodyEndLocation());
 }
 
 void QASTNode::prepend(const QString& value){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     insert(value, bodyStartLocation());
 }
 
 void QASTNode::before(const QString& value){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     insert(value, rangeStartLocation());
 }
 
 void QASTNode::after(const QString& value){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     insert(value, rangeEndLocation());
 }
 
 void QASTNode::afterln(const QString& value){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     if ( !m_tokenSet )
         after(value);
 
@@ -153,6 +214,7 @@ void QASTNode::afterln(const QString& value){
 }
 
 void QASTNode::remove(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     erase(rangeStartLocation(), rangeEndLocation());
 }
 
@@ -217,26 +279,43 @@ QList<QObject*> QASTNode::find(const QASTSearch& searchPattern, const QString& t
 }
 
 bool QASTNode::insert(const QString& value, QSourceLocation* location){
-    QASTNode* p = astParent();
+    QASTNode* p = qobject_cast<QASTNode*>(parent());
     if ( p )
         return p->insert(value, location);
     return false;
 }
 
 bool QASTNode::erase(QSourceLocation *from, QSourceLocation *to){
-    QASTNode* p = astParent();
+    QASTNode* p = qobject_cast<QASTNode*>(parent());
     if ( p )
         return p->erase(from, to);
     return false;
 }
 
 QString QASTNode::text(QSourceLocation *from, QSourceLocation *to){
-    QASTNode* p = astParent();
+    QASTNode* p = qobject_cast<QASTNode*>(parent());
     if ( p )
         return p->text(from, to);
     return "";
 }
 
+void QASTNode::addChild(QASTNode *node){
+    if ( !hasRange(node) ){
+        m_children.insert(std::find_if(m_children.begin(), m_children.end(), hasRange), node);
+        return;
+    }
+
+    if ( m_children.isEmpty() || rangeStartOffset(m_children.last()) <= rangeStartOffset(node) ){
+        m_children.append(node);
+        return;
+    }
+
+    m_children.insert(
+        std::upper_bound(m_children.begin(), m_children.end(), rangeStartOffset(node), offsetBeforeNode),
+        node
+    );
+}
+
 void QASTNode::setAstParent(QASTNode* parent){
     if ( parent )
         parent->addChild(this);
@@ -244,19 +323,62 @@ void QASTNode::setAstParent(QASTNode* parent){
 }
 
 QASTNode *QASTNode::propagateUserCursor(const QSourceLocation &location){
-    QASTNode* base = 0;
-    if ( m_rangeStartLocation->offset() <= location.offset() && m_rangeEndLocation->offset() >= location.offset() ){
-        base = this;
-        for ( NodeList::iterator it = m_children.begin(); it != m_children.end(); ++it ){
-            QASTNode* result = (*it)->propagateUserCursor(location);
-            if ( result != 0 )
-                base = result;
-        }
+    if ( !containsOffset(location.offset()) )
+        return 0;
+
+    QASTNode* base  = this;
+    QASTNode* child = childAt(location.offset());
+    while ( child != 0 ){
+        base  = child;
+        child = child->childAt(location.offset());
     }
     return base;
 }
 
+bool QASTNode::containsOffset(unsigned int offset){
+    if ( !m_rangeStartLocation || !m_rangeEndLocation )
+        return false;
+    return m_rangeStartLocation->offset() <= offset && m_rangeEndLocation->offset() >= offset;
+}
+
+QASTNode* QASTNode::childAt(unsigned int offset){
+    // The latest starting child containing the offset is the innermost one among overlapping siblings
+    NodeList::iterator it = std::upper_bound(m_children.begin(), m_children.end(), offset, offsetBeforeNode);
+    while ( it != m_children.begin() ){
+        --it;
+        if ( (*it)->containsOffset(offset) )
+            return *it;
+    }
+    return 0;
+}
+
+QList<QObject*> QASTNode::nodesInRange(unsigned int from, unsigned int to){
+    QList<QObject*> foundNodes;
+    if ( from <= to )
+        collectNodesInRange(from, to, foundNodes);
+    return foundNodes;
+}
+
+QList<QObject*> QASTNode::nodesInRange(QSourceLocation* from, QSourceLocation* to){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( !from || !to )
+        return QList<QObject*>();
+    return retainScriptValues(nodesInRange(from->offset(), to->offset()));
+}
+
+void QASTNode::collectNodesInRange(unsigned int from, unsigned int to, QList<QObject*>& result){
+    NodeList::iterator it = std::find_if(m_children.begin(), m_children.end(), hasRange);
+    while ( it != m_children.end() && rangeStartOffset(*it) <= to ){
+        if ( rangeEndOffset(*it) >= from ){
+            result.append(*it);
+            (*it)->collectNodesInRange(from, to, result);
+        }
+        ++it;
+    }
+}
+
 QASTNode *QASTNode::findNode(QASTNode* node){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     for ( NodeList::iterator it = m_children.begin(); it != m_children.end(); ++it ){
         QASTNode* child = *it;
         if ( child == node )
@@ -269,8 +391,10 @@ QASTNode *QASTNode::findNode(QASTNode* node){
 }
 
 QList<QObject*> QASTNode::find(const QString &searchData, const QString& type){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QCSAProfiler::PhaseScope profilerPhase(QCSAProfiler::Find);
     if ( QASTSearch::isPattern(searchData) )
-        return find(QASTSearch(searchData), type);
+        return retainScriptValues(find(QASTSearch(searchData), type));
 
     QList<QObject*> foundData;
     if ( identifier() == searchData && (type == "" || type == typeName()) )
@@ -284,40 +408,97 @@ QList<QObject*> QASTNode::find(const QString &searchData, const QString& type){
             foundData << foundChildren;
     }
 
-    return foundData;
+    return retainScriptValues(foundData);
 }
 
 QASTNode* QASTNode::findFirst(const QString& searchData, const QString& type){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QCSAProfiler::PhaseScope profilerPhase(QCSAProfiler::Find);
     if ( QASTSearch::isPattern(searchData) )
-        return findFirst(QASTSearch(searchData), type);
+        return retainScriptValue(findFirst(QASTSearch(searchData), type));
 
     if ( identifier() == searchData && (type == "" || type == typeName()) )
-        return this;
+        return retainScriptValue(this);
 
     for ( NodeList::iterator it = m_children.begin(); it != m_children.end(); ++it ){
         QASTNode* child = *it;
         QASTNode* foundChild = child->findFirst(searchData, type);
         if ( foundChild )
-            return foundChild;
+            return retainScriptValue(foundChild);
     }
 
     return 0;
 }
 
 QASTNode* QASTNode::parentFind(const QString& typeString){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     if ( parent() == 0 )
         return 0;
 
     QASTNode* p = qobject_cast<QASTNode*>(parent());
     if ( p ){
         if ( p->typeName() == typeString )
-            return p;
-        return p->parentFind(typeString);
+            return retainScriptValue(p);
+        return retainScriptValue(p->parentFind(typeString));
     }
 
     return 0;
 }
 
+bool QASTNode::visit(const QJSValue& callback, const QStringList& kinds, int maxDepth){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QJSEngine* engine = callingEngine(this);
+    if ( !engine || !callback.isCallable() ){
+        QCSAConsole::logError("Cannot visit nodes of \'" + identifier() + "\'. The callback is not a function.");
+        return false;
+    }
+
+    QJSValue visitCallback(callback);
+    return visitChildren(engine, visitCallback, kinds, maxDepth, 1) != VisitStop;
+}
+
+QASTNode::VisitResult QASTNode::visitChildren(
+        QJSEngine* engine,
+        QJSValue& callback,
+        const QStringList& kinds,
+        int maxDepth,
+        int depth)
+{
+    if ( maxDepth != -1 && depth > maxDepth )
+        return VisitContinue;
+
+    for ( NodeList::iterator it = m_children.begin(); it != m_children.end(); ++it ){
+        QASTNode* child = *it;
+
+        // Nodes of other kinds are walked through without calling back into javascript
+        if ( kinds.isEmpty() || kinds.contains(child->typeName()) ){
+            QJSValue result;
+            {
+                QCSAProfiler::ScriptScope profilerScript;
+                result = callback.call(QJSValueList() << child->scriptValue(engine) << depth);
+            }
+            if ( result.isError() ){
+                QCSAConsole::logError("Uncaught javascript exception in visit: " + result.toString());
+                return VisitStop;
+            }
+
+            // Callbacks return 'skip' to leave out the children of the visited node, or 'stop' to end the traversal
+            QString action = result.isString() ? result.toString() : QString();
+            VisitResult visitResult =
+                action == "stop" ? VisitStop : action == "skip" ? VisitSkipChildren : VisitContinue;
+
+            if ( visitResult == VisitStop )
+                return VisitStop;
+            if ( visitResult == VisitSkipChildren )
+                continue;
+        }
+
+        if ( child->visitChildren(engine, callback, kinds, maxDepth, depth + 1) == VisitStop )
+            return VisitStop;
+    }
+    return VisitContinue;
+}
+
 QASTNode* QASTNode::childAfter(QASTNode* child){
     for ( NodeList::iterator it = m_children.begin(); it != m_children.end(); ++it ){
         QASTNode* currentChild = *it;
@@ -349,17 +530,61 @@ QList<QObject*> QASTNode::castNodeListToObjectList(const QList<QASTNode*>& list)
     return objectList;
 }
 
+QJSValue QASTNode::scriptValue(QJSEngine* engine){
+    if ( !engine )
+        return QJSValue();
+    if ( m_scriptEngine == engine )
+        return m_scriptValue;
+
+    // Nodes are owned by the code base, the garbage collector must never delete them. Ownership is only set from the
+    // thread owning the node, the worker pool sets it for the nodes workers can reach before they start.
+    bool isOwnerThread = QThread::currentThread() == thread();
+    if ( isOwnerThread )
+        QQmlEngine::setObjectOwnership(this, QQmlEngine::CppOwnership);
+    QJSValue value = engine->newQObject(this);
+
+    // Only the first engine keeps its wrapper. Holding it prevents the wrapper from being collected, so the engine
+    // hands out the same object every time the node is returned to javascript. The wrapper is only kept for an
+    // engine living on the calling thread, so worker engines never keep one.
+    if ( m_scriptEngine.isNull() && isOwnerThread && engine->thread() == QThread::currentThread() ){
+        m_scriptEngine = engine;
+        m_scriptValue  = value;
+    }
+    return value;
+}
+
+QASTNode* QASTNode::retainScriptValue(QASTNode* node){
+    // Nodes are only retained when returned to the engine this node is exposed to, native lookups stay wrapper free
+    if ( node ){
+        QJSEngine* engine = callingEngine(this);
+        if ( engine && engine->thread() == QThread::currentThread() )
+            node->scriptValue(engine);
+    }
+    return node;
+}
+
+const QList<QObject*>& QASTNode::retainScriptValues(const QList<QObject*>& nodes){
+    QJSEngine* engine = callingEngine(this);
+    if ( engine && engine->thread() == QThread::currentThread() ){
+        for ( QList<QObject*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it )
+            static_cast<QASTNode*>(*it)->scriptValue(engine);
+    }
+    return nodes;
+}
+
 QASTNode* QASTNode::next(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     QASTNode* p = qobject_cast<QASTNode*>(parent());
     if ( p )
-        return p->childAfter(this);
+        return retainScriptValue(p->childAfter(this));
     return 0;
 }
 
 QASTNode *QASTNode::prev(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     QASTNode* p = qobject_cast<QASTNode*>(parent());
     if ( p )
-        return p->childBefore(this);
+        return retainScriptValue(p->childBefore(this));
     return 0;
 }
 
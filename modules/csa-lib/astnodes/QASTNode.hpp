@@ -19,9 +19,15 @@
 #define QASTNODE_HPP
 
 #include "QCSAGlobal.hpp"
+#include "QCSAProfiler.hpp"
 #include <QObject>
 #include <QList>
 #include <QVariant>
+#include <QStringList>
+#include <QPointer>
+#include <QJSValue>
+
+class QJSEngine;
 
 namespace csa{
 
@@ -96,6 +102,9 @@ public slots:
     QList<QObject*> find(const QString& searchData, const QString& type = "");
     csa::ast::QASTNode* findFirst(const QString& searchData, const QString& type = "");
     csa::ast::QASTNode* parentFind(const QString& typeString);
+    QList<QObject*> nodesInRange(csa::QSourceLocation* from, csa::QSourceLocation* to);
+
+    bool visit(const QJSValue& callback, const QStringList& kinds = QStringList(), int maxDepth = -1);
 
     // Modifiers
     // ---------
@@ -124,6 +133,13 @@ public:
 
     virtual QASTNode* propagateUserCursor(const QSourceLocation& location);
 
+    // Range Queries
+    // -------------
+
+    bool containsOffset(unsigned int offset);
+    csa::ast::QASTNode* childAt(unsigned int offset);
+    QList<QObject*> nodesInRange(unsigned int from, unsigned int to);
+
     // Children Handlers
     // -----------------
 
@@ -141,6 +157,11 @@ public:
 
     void setAstParent(csa::ast::QASTNode* parent);
 
+    // Scripting
+    // ---------
+
+    QJSValue scriptValue(QJSEngine* engine);
+
     // Debugging
     // ---------
 
@@ -158,6 +179,18 @@ protected:
 
     static QList<QObject*> castNodeListToObjectList(const QList<QASTNode*>& list);
 
+    csa::ast::QASTNode* retainScriptValue(csa::ast::QASTNode* node);
+    const QList<QObject*>& retainScriptValues(const QList<QObject*>& nodes);
+
+    void collectNodesInRange(unsigned int from, unsigned int to, QList<QObject*>& result);
+
+    enum VisitResult{
+        VisitContinue,
+        VisitSkipChildren,
+        VisitStop
+    };
+    VisitResult visitChildren(QJSEngine* engine, QJSValue& callback, const QStringList& kinds, int maxDepth, int depth);
+
     virtual QString text(QSourceLocation *from, QSourceLocation *to);
 
 private:
@@ -177,6 +210,11 @@ private:
     QASTNode*    m_parent;
     QCodeBase*   m_codeBase;
 
+    // Wrapper handed to the first engine the node is exposed to. It is released together with the node, which
+    // happens for every node of a file on reparse.
+    QJSValue            m_scriptValue;
+    QPointer<QJSEngine> m_scriptEngine;
+
 };
 
 inline void QASTNode::setIdentifier(const QString &identifier){
@@ -188,10 +226,12 @@ inline QAnnotatedTokenSet*QASTNode::tokenSet(){
 }
 
 inline QString QASTNode::typeName() const{
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return m_typeName;
 }
 
 inline QString QASTNode::identifier() const{
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return m_identifier;
 }
 
@@ -209,20 +249,21 @@ inline QList<QASTNode*> QASTNode::astChildren(const QString &type) const{
 }
 
 inline QASTNode* QASTNode::firstChild(const QString &identif, const QString &typeString){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     if ( identif == "" ){
         if ( m_children.size() > 0 )
-            return m_children.first();
+            return retainScriptValue(m_children.first());
 
     } else if ( typeString == "" ){
         for ( NodeList::iterator it = m_children.begin(); it != m_children.end(); ++it ){
             if ( (*it)->identifier() == identif )
-                return *it;
+                return retainScriptValue(*it);
         }
 
     } else {
         for ( NodeList::iterator it = m_children.begin(); it != m_children.end(); ++it ){
             if ( (*it)->identifier() == identif && (*it)->typeName() == typeString )
-                return *it;
+                return retainScriptValue(*it);
         }
     }
 
@@ -230,22 +271,23 @@ inline QASTNode* QASTNode::firstChild(const QString &identif, const QString &typ
 }
 
 inline QASTNode *QASTNode::lastChild(const QString &identif, const QString &typeString){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     if ( identif == "" ){
         if ( m_children.size() > 0 )
-            return m_children.last();
+            return retainScriptValue(m_children.last());
 
     } else if ( typeString == "" ){
         for( int i = m_children.size() - 1; i >= 0; --i ){
             QASTNode* node = m_children[i];
             if ( node->identifier() == identif)
-                return node;
+                return retainScriptValue(node);
         }
 
     } else {
         for( int i = m_children.size() - 1; i >= 0; --i ){
             QASTNode* node = m_children[i];
             if ( node->identifier() == identif && node->typeName() == typeString)
-                return node;
+                return retainScriptValue(node);
         }
     }
 
@@ -253,29 +295,30 @@ inline QASTNode *QASTNode::lastChild(const QString &identif, const QString &type
 }
 
 inline QSourceLocation* QASTNode::rangeStartLocation(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return m_rangeStartLocation;
 }
 
 inline QSourceLocation* QASTNode::rangeEndLocation(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return m_rangeEndLocation;
 }
 
 inline QSourceLocation* QASTNode::cursorLocation(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return m_cursorLocation;
 }
 
 inline QSourceLocation* QASTNode::bodyStartLocation(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return m_rangeStartLocation;
 }
 
 inline QSourceLocation* QASTNode::bodyEndLocation(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return m_rangeEndLocation;
 }
 
-inline void QASTNode::addChild(QASTNode *node){
-    m_children.push_back(node);
-}
-
 inline QASTNode::Iterator QASTNode::childrenBegin(){
     return m_children.begin();
 }
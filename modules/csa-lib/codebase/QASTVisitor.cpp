@@ -52,6 +52,40 @@ private:
 };
 
 
+// Roots and classifiers of the files built from a single translation unit, matched by the file of each cursor
+class VisitorFileTargets{
+
+public:
+    VisitorFileTargets(const std::vector<QASTNode*>& roots, const std::vector<QTokenClassifier*>& classifiers)
+        : m_roots(roots)
+        , m_classifiers(classifiers){
+
+        for ( size_t i = 0; i < m_classifiers.size(); ++i ){
+            m_files.push_back(
+                clang_getFile(m_classifiers[i]->translationUnit(), m_classifiers[i]->file().c_str())
+            );
+        }
+    }
+
+    int findFile(CXFile file) const{
+        for ( size_t i = 0; i < m_files.size(); ++i ){
+            if ( m_files[i] == file )
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    QASTNode* root(int index){ return m_roots[index]; }
+    QTokenClassifier* classifier(int index){ return m_classifiers[index]; }
+
+private:
+    const std::vector<QASTNode*>&         m_roots;
+    const std::vector<QTokenClassifier*>& m_classifiers;
+    std::vector<CXFile>                   m_files;
+
+};
+
+
 QASTVisitor::QASTVisitor(){
 }
 
@@ -59,6 +93,43 @@ void QASTVisitor::createCSANodeTree(const CXCursor &rootCursor, QASTNode *root,
     VisitorClientData* data = new VisitorClientData(classifier, root);
     clang_visitChildren(rootCursor, QASTVisitor::callback, (CXClientData)data);
     delete data;
+
+    attachUnownedTokenSets(root, classifier);
+}
+
+void QASTVisitor::createCSANodeTrees(
+        const CXCursor &rootCursor,
+        const std::vector<QASTNode*>& roots,
+        const std::vector<QTokenClassifier*>& classifiers)
+{
+    VisitorFileTargets targets(roots, classifiers);
+    clang_visitChildren(rootCursor, QASTVisitor::fileCallback, (CXClientData)&targets);
+
+    for ( size_t i = 0; i < roots.size(); ++i )
+        attachUnownedTokenSets(roots[i], classifiers[i]);
+}
+
+void QASTVisitor::attachUnownedTokenSets(QASTNode* root, QTokenClassifier* classifier){
+    // Token sets of cursors without a node are attached to the root, so their tokens can still be used as insertion
+    // points
+    for ( QTokenClassifier::Iterator it = classifier->tokenSetBegin(); it != classifier->tokenSetEnd(); ++it ){
+        if ( (*it)->parent() == 0 )
+            (*it)->setParent(root);
+    }
+}
+
+CXChildVisitResult QASTVisitor::fileCallback(CXCursor cursor, CXCursor parent, CXClientData data){
+    VisitorFileTargets* targets = static_cast<VisitorFileTargets*>(data);
+
+    CXFile cursorFile;
+    clang_getSpellingLocation(clang_getCursorLocation(cursor), &cursorFile, 0, 0, 0);
+
+    int fileIndex = targets->findFile(cursorFile);
+    if ( fileIndex == -1 )
+        return CXChildVisit_Continue;
+
+    VisitorClientData fileData(targets->classifier(fileIndex), targets->root(fileIndex));
+    return callback(cursor, parent, &fileData);
 }
 
 CXChildVisitResult QASTVisitor::callback(CXCursor cursor, CXCursor, CXClientData data){
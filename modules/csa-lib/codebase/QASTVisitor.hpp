@@ -20,6 +20,7 @@
 
 #include "clang-c/Index.h"
 #include "QCSAGlobal.hpp"
+#include <vector>
 
 namespace csa{
 
@@ -33,7 +34,16 @@ public:
     QASTVisitor();
 
     static void createCSANodeTree(const CXCursor& rootCursor, ast::QASTNode* root, QTokenClassifier* classifier );
+    static void createCSANodeTrees(
+            const CXCursor& rootCursor,
+            const std::vector<ast::QASTNode*>& roots,
+            const std::vector<QTokenClassifier*>& classifiers);
+
     static CXChildVisitResult callback(CXCursor cursor, CXCursor, CXClientData data);
+    static CXChildVisitResult fileCallback(CXCursor cursor, CXCursor parent, CXClientData data);
+
+private:
+    static void attachUnownedTokenSets(ast::QASTNode* root, QTokenClassifier* classifier);
 
 };
 
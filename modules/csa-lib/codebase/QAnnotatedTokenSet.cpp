@@ -56,6 +56,15 @@ void QAnnotatedTokenSet::append(const CXToken &token){
     d->tokens.append(new QAnnotatedToken(token, this));
 }
 
+void QAnnotatedTokenSet::reset(const CXCursor& cursor, const CXTranslationUnit& tu){
+    Q_D(QAnnotatedTokenSet);
+    for ( QAnnotatedTokenSet::Iterator it = begin(); it != end(); ++it )
+        delete *it;
+    d->tokens.clear();
+    d->cursor          = cursor;
+    d->translationUnit = tu;
+}
+
 bool QAnnotatedTokenSet::operator ==(const QAnnotatedTokenSet &other){
     Q_D(QAnnotatedTokenSet);
     return clang_equalCursors(d->cursor, other.cursor());
@@ -45,6 +45,7 @@ public:
     ~QAnnotatedTokenSet();
 
     void append(const CXToken& token);
+    void reset(const CXCursor& cursor, const CXTranslationUnit& tu);
 
     bool operator ==(const QAnnotatedTokenSet& other);
     bool operator !=(const QAnnotatedTokenSet& other);
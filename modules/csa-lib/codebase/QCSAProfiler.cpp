@@ -0,0 +1,196 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#include "QCSAProfiler.hpp"
+#include <QThread>
+#include <QJsonArray>
+#include <QRegularExpression>
+#include <QStringList>
+
+namespace csa{
+
+namespace{
+
+// Reduces a function signature to its class and name, e.g. 'QASTNode::find'
+QString slotName(const char* function){
+    static QRegularExpression nameExpression("(\\w+::~?\\w+)\\s*\\(");
+    QString signature = QString::fromLatin1(function);
+    QRegularExpressionMatch match = nameExpression.match(signature);
+    return match.hasMatch() ? match.captured(1) : signature;
+}
+
+QString formatTime(qint64 nsecs){
+    return QString::number(static_cast<double>(nsecs) / 1000000.0, 'f', 3) + "ms";
+}
+
+}// namespace
+
+bool QCSAProfiler::profilingEnabled = false;
+
+// QCSAProfiler::Command Definitions
+// ---------------------------------
+
+QCSAProfiler::Command::Command()
+    : total(0)
+{
+    for ( int i = 0; i < TotalPhases; ++i )
+        phases[i] = 0;
+}
+
+// QCSAProfiler Definitions
+// ------------------------
+
+QCSAProfiler::QCSAProfiler()
+    : m_thread(0)
+    , m_commandActive(false)
+    , m_commandStart(0)
+    , m_phaseStart(0)
+    , m_callDepth(0)
+{
+    m_clock.start();
+}
+
+QCSAProfiler::~QCSAProfiler(){
+}
+
+QCSAProfiler& QCSAProfiler::instance(){
+    static QCSAProfiler profiler;
+    return profiler;
+}
+
+void QCSAProfiler::setEnabled(bool enable){
+    m_thread = QThread::currentThread();
+    profilingEnabled = enable;
+}
+
+bool QCSAProfiler::beginCommand(const QString& command){
+    if ( !profilingEnabled || QThread::currentThread() != m_thread || m_commandActive )
+        return false;
+
+    m_current         = Command();
+    m_current.command = command;
+    m_commandActive   = true;
+    m_callDepth       = 1;
+    m_commandStart    = m_clock.nsecsElapsed();
+    m_phaseStart      = m_commandStart;
+
+    m_phaseStack.clear();
+    m_phaseStack.append(Script);
+    return true;
+}
+
+void QCSAProfiler::endCommand(){
+    if ( !isRecording() )
+        return;
+
+    creditCurrentPhase();
+    m_current.total = m_clock.nsecsElapsed() - m_commandStart;
+    m_commands.append(m_current);
+    m_commandActive = false;
+    m_phaseStack.clear();
+}
+
+void QCSAProfiler::clear(){
+    m_commands.clear();
+    m_calls.clear();
+}
+
+bool QCSAProfiler::isRecording() const{
+    return m_commandActive && QThread::currentThread() == m_thread;
+}
+
+void QCSAProfiler::pushPhase(Phase phase){
+    creditCurrentPhase();
+    m_phaseStack.append(phase);
+}
+
+void QCSAProfiler::popPhase(){
+    creditCurrentPhase();
+    if ( m_phaseStack.size() > 1 )
+        m_phaseStack.removeLast();
+}
+
+void QCSAProfiler::creditCurrentPhase(){
+    qint64 now = m_clock.nsecsElapsed();
+    if ( !m_phaseStack.isEmpty() )
+        m_current.phases[m_phaseStack.last()] += now - m_phaseStart;
+    m_phaseStart = now;
+}
+
+QHash<QString, int> QCSAProfiler::callCounts() const{
+    // Overloads of the same slot share a name, so their counts are merged
+    QHash<QString, int> counts;
+    for ( QHash<const char*, int>::const_iterator it = m_calls.begin(); it != m_calls.end(); ++it )
+        counts[slotName(it.key())] += it.value();
+    return counts;
+}
+
+QJsonObject QCSAProfiler::toJson() const{
+    QJsonArray commands;
+    for ( QList<Command>::const_iterator it = m_commands.begin(); it != m_commands.end(); ++it ){
+        QJsonObject phases;
+        for ( int i = 0; i < TotalPhases; ++i )
+            phases[phaseName(static_cast<Phase>(i))] = static_cast<double>(it->phases[i]) / 1000000.0;
+
+        QJsonObject command;
+        command["command"] = it->command;
+        command["total"]   = static_cast<double>(it->total) / 1000000.0;
+        command["phases"]  = phases;
+        commands.append(command);
+    }
+
+    QJsonObject calls;
+    QHash<QString, int> counts = callCounts();
+    for ( QHash<QString, int>::const_iterator it = counts.begin(); it != counts.end(); ++it )
+        calls[it.key()] = it.value();
+
+    QJsonObject profile;
+    profile["commands"] = commands;
+    profile["calls"]    = calls;
+    return profile;
+}
+
+QString QCSAProfiler::toString() const{
+    QString out("Profile:\n");
+    for ( QList<Command>::const_iterator it = m_commands.begin(); it != m_commands.end(); ++it ){
+        out += "  " + it->command + " : " + formatTime(it->total) + "\n";
+        for ( int i = 0; i < TotalPhases; ++i )
+            out += "    " + phaseName(static_cast<Phase>(i)).leftJustified(8) + formatTime(it->phases[i]) + "\n";
+    }
+
+    QHash<QString, int> counts = callCounts();
+    QStringList names = counts.keys();
+    names.sort();
+
+    out += "Slot calls:\n";
+    for ( QStringList::const_iterator it = names.begin(); it != names.end(); ++it )
+        out += "  " + it->leftJustified(32) + QString::number(counts[*it]) + "\n";
+    return out;
+}
+
+QString QCSAProfiler::phaseName(Phase phase){
+    switch( phase ){
+    case Script:  return "script";
+    case Find:    return "find";
+    case Save:    return "save";
+    case Reparse: return "reparse";
+    case FileIO:  return "fileio";
+    default:      return "";
+    }
+}
+
+}// namespace
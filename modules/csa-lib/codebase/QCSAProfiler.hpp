@@ -0,0 +1,201 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#ifndef QCSAPROFILER_HPP
+#define QCSAPROFILER_HPP
+
+#include "QCSAGlobal.hpp"
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QJsonObject>
+
+class QThread;
+
+namespace csa{
+
+// Records the wall time of each script command, split into the phases it spent its time in, together with the number
+// of calls scripts make into exposed slots. Phases are exclusive: time spent in a nested phase is only credited to the
+// nested one, and whatever is left is credited to the script itself. Only the thread that enabled profiling is
+// recorded, and only while a command runs.
+class Q_CSA_EXPORT QCSAProfiler{
+
+public:
+    enum Phase{
+        Script = 0,
+        Find,
+        Save,
+        Reparse,
+        FileIO,
+        TotalPhases
+    };
+
+    // Records a command, commands started within it are part of the outer one
+    class CommandScope{
+    public:
+        explicit CommandScope(const QString& command);
+        ~CommandScope();
+    private:
+        bool m_active;
+    };
+
+    // Credits the time spent within its scope to a phase
+    class PhaseScope{
+    public:
+        explicit PhaseScope(Phase phase);
+        ~PhaseScope();
+    private:
+        bool m_active;
+    };
+
+    // Counts a slot call. Calls made while another counted slot runs are native ones, and are not counted.
+    class CallScope{
+    public:
+        explicit CallScope(const char* function);
+        ~CallScope();
+    private:
+        bool m_active;
+    };
+
+    // Runs javascript, where slot calls are counted again. Commands start on the native side.
+    class ScriptScope{
+    public:
+        ScriptScope();
+        ~ScriptScope();
+    private:
+        bool m_active;
+        int  m_callDepth;
+    };
+
+public:
+    static QCSAProfiler& instance();
+
+    static bool isEnabled();
+    void setEnabled(bool enable);
+
+    bool beginCommand(const QString& command);
+    void endCommand();
+
+    void clear();
+
+    QJsonObject toJson() const;
+    QString toString() const;
+
+    static QString phaseName(Phase phase);
+
+private:
+    QCSAProfiler();
+    ~QCSAProfiler();
+
+    // prevent copy
+    QCSAProfiler(const QCSAProfiler& other);
+    QCSAProfiler& operator = (const QCSAProfiler& other);
+
+    class Command{
+    public:
+        Command();
+
+        QString command;
+        qint64  total;
+        qint64  phases[TotalPhases];
+    };
+
+    bool isRecording() const;
+    void pushPhase(Phase phase);
+    void popPhase();
+    void creditCurrentPhase();
+
+    QHash<QString, int> callCounts() const;
+
+    static bool profilingEnabled;
+
+    QThread*       m_thread;
+    QElapsedTimer  m_clock;
+
+    bool           m_commandActive;
+    qint64         m_commandStart;
+    qint64         m_phaseStart;
+    QList<Phase>   m_phaseStack;
+    Command        m_current;
+    QList<Command> m_commands;
+
+    // Keyed by the function signature literal, names are only extracted for output
+    QHash<const char*, int> m_calls;
+    int                     m_callDepth;
+};
+
+inline bool QCSAProfiler::isEnabled(){
+    return profilingEnabled;
+}
+
+inline QCSAProfiler::CommandScope::CommandScope(const QString& command)
+    : m_active(profilingEnabled && instance().beginCommand(command))
+{
+}
+
+inline QCSAProfiler::CommandScope::~CommandScope(){
+    if ( m_active )
+        instance().endCommand();
+}
+
+inline QCSAProfiler::PhaseScope::PhaseScope(Phase phase)
+    : m_active(profilingEnabled && instance().isRecording())
+{
+    if ( m_active )
+        instance().pushPhase(phase);
+}
+
+inline QCSAProfiler::PhaseScope::~PhaseScope(){
+    if ( m_active )
+        instance().popPhase();
+}
+
+inline QCSAProfiler::CallScope::CallScope(const char* function)
+    : m_active(profilingEnabled && instance().isRecording())
+{
+    if ( m_active ){
+        QCSAProfiler& profiler = instance();
+        if ( profiler.m_callDepth == 0 )
+            ++profiler.m_calls[function];
+        ++profiler.m_callDepth;
+    }
+}
+
+inline QCSAProfiler::CallScope::~CallScope(){
+    if ( m_active )
+        --instance().m_callDepth;
+}
+
+inline QCSAProfiler::ScriptScope::ScriptScope()
+    : m_active(profilingEnabled && instance().isRecording())
+    , m_callDepth(0)
+{
+    if ( m_active ){
+        m_callDepth = instance().m_callDepth;
+        instance().m_callDepth = 0;
+    }
+}
+
+inline QCSAProfiler::ScriptScope::~ScriptScope(){
+    if ( m_active )
+        instance().m_callDepth = m_callDepth;
+}
+
+}// namespace
+
+#endif // QCSAPROFILER_HPP
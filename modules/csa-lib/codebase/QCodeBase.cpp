@@ -25,8 +25,18 @@
 #include "QASTVisitor.hpp"
 #include "QASTSearch.hpp"
 #include "QCSAConsole.hpp"
+#include "QPrecompiledHeader.hpp"
+#include "QTranslationUnitCache.hpp"
+#include "QCSAProfiler.hpp"
+#include "QCSAWorkerPool.hpp"
 #include <QMap>
 #include <QHash>
+#include <QSet>
+#include <QThread>
+#include <QDateTime>
+#include <QtConcurrent/QtConcurrentMap>
+#include <vector>
+#include <algorithm>
 
 namespace csa{
 
@@ -37,6 +47,176 @@ public:
     CXIndex index;
 };
 
+namespace{
+
+// Contents of files that differ from the ones on disk, passed on to libclang when parsing
+class QUnsavedFiles{
+public:
+    explicit QUnsavedFiles(const QList<QASTFile*>& files){
+        for ( QList<QASTFile*>::const_iterator it = files.begin(); it != files.end(); ++it ){
+            QASTFile* file = *it;
+
+            // Files with pending modifications are about to be written, so their disk contents are used instead
+            if ( file->hasUnsavedContent() && !file->hasModifiers() )
+                append(file->identifier(), file->content());
+        }
+    }
+
+    // The content is not copied, so it needs to outlive this object
+    void append(const QString& path, const QByteArray& content){
+        m_paths.append(path.toLocal8Bit());
+
+        CXUnsavedFile unsavedFile;
+        unsavedFile.Filename = m_paths.last().constData();
+        unsavedFile.Contents = content.constData();
+        unsavedFile.Length   = static_cast<unsigned long>(content.size());
+        m_files.push_back(unsavedFile);
+    }
+
+    unsigned int size(){ return static_cast<unsigned int>(m_files.size()); }
+    CXUnsavedFile* data(){ return m_files.empty() ? 0 : &m_files.front(); }
+
+private:
+    QList<QByteArray>          m_paths;
+    std::vector<CXUnsavedFile> m_files;
+};
+
+const unsigned int translationUnitParseOptions = CXTranslationUnit_Incomplete | CXTranslationUnit_CXXChainedPCH;
+
+// Translation unit reparsed on a worker thread, together with the files built from it. Units loaded from the cache,
+// and units libclang failed to reparse, are parsed again with the given index and arguments, into a new unit.
+class QPendingReparse{
+public:
+    QPendingReparse(
+            CXTranslationUnit pTransUnit = 0,
+            QUnsavedFiles* pUnsavedFiles = 0,
+            CXIndex pIndex = 0,
+            const char* const* pArgs = 0,
+            int pNumArgs = 0,
+            bool pCached = false)
+        : transUnit(pTransUnit)
+        , parsedTransUnit(pTransUnit)
+        , unsavedFiles(pUnsavedFiles)
+        , index(pIndex)
+        , args(pArgs)
+        , numArgs(pNumArgs)
+        , cached(pCached)
+        , reparseFailed(false){}
+
+    CXTranslationUnit  transUnit;
+    CXTranslationUnit  parsedTransUnit;
+    QUnsavedFiles*     unsavedFiles;
+    CXIndex            index;
+    const char* const* args;
+    int                numArgs;
+    bool               cached;
+    bool               reparseFailed;
+    QList<int>         indexes;
+    QList<QASTFile*>   roots;
+};
+
+QStringList defaultSourceSearchPatterns(){
+    return QStringList() << "*.c" << "*.C" << "*.cxx" << "*.cpp" << "*.c++" << "*.cc" << "*.cp";
+}
+
+char* copyArgument(const char* argument){
+    char* copy = new char[strlen(argument) + 1];
+    strcpy(copy, argument);
+    return copy;
+}
+
+// Key under which a file is stored in the inclusion graph, independent of how its path was spelled
+QString inclusionKey(const QString& path){
+    return QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+}
+
+class QInclusionCollector{
+public:
+    QInclusionCollector(CXTranslationUnit pTransUnit) : transUnit(pTransUnit){}
+
+    CXTranslationUnit transUnit;
+    QStringList       inclusions;
+};
+
+void collectInclusion(CXFile includedFile, CXSourceLocation*, unsigned int includeDepth, CXClientData data){
+    QInclusionCollector* collector = static_cast<QInclusionCollector*>(data);
+
+    // The main file of the translation unit is reported with an empty include stack. System headers are left out,
+    // since they are never edited, and checking them for changes before each command would be costly.
+    if ( includeDepth == 0 ||
+         clang_Location_isInSystemHeader(clang_getLocationForOffset(collector->transUnit, includedFile, 0)) )
+        return;
+
+    CXString fileName = clang_getFileName(includedFile);
+    collector->inclusions.append(inclusionKey(QString::fromUtf8(clang_getCString(fileName))));
+    clang_disposeString(fileName);
+}
+
+QStringList translationUnitInclusions(CXTranslationUnit transUnit){
+    QInclusionCollector collector(transUnit);
+    clang_getInclusions(transUnit, collectInclusion, &collector);
+    collector.inclusions.removeDuplicates();
+    return collector.inclusions;
+}
+
+// File written on a worker thread before the translation units are reparsed
+class QPendingSave{
+public:
+    QPendingSave(QASTFile* pRoot = 0) : root(pRoot), saved(false){}
+
+    QASTFile* root;
+    bool      saved;
+};
+
+void writePendingFile(QPendingSave& pending){
+    pending.saved = pending.root->save();
+}
+
+// Reloads the file contents and reparses the translation unit. Neither touches the node trees, so this is safe to run
+// concurrently for different translation units.
+void reparsePendingTranslationUnit(QPendingReparse& pending){
+    for ( QList<QASTFile*>::iterator it = pending.roots.begin(); it != pending.roots.end(); ++it )
+        (*it)->reloadContent();
+
+    // The spelling is taken first, since a unit that failed to reparse can only be disposed
+    CXString fileName = clang_getTranslationUnitSpelling(pending.transUnit);
+
+    if ( !pending.cached ){
+        int reparseResult = clang_reparseTranslationUnit(
+            pending.transUnit,
+            pending.unsavedFiles->size(),
+            pending.unsavedFiles->data(),
+            clang_defaultReparseOptions(pending.transUnit)
+        );
+        if ( reparseResult == 0 ){
+            clang_disposeString(fileName);
+            return;
+        }
+        pending.reparseFailed = true;
+    }
+
+    pending.parsedTransUnit = clang_parseTranslationUnit(
+        pending.index,
+        clang_getCString(fileName),
+        pending.args,
+        pending.numArgs,
+        pending.unsavedFiles->data(),
+        pending.unsavedFiles->size(),
+        translationUnitParseOptions
+    );
+    clang_disposeString(fileName);
+}
+
+// Script workers get a read only view of the code base, edits and parsing are left to the thread owning it
+bool isOwnerThread(const QCodeBase* codeBase, const QString& operation){
+    if ( QThread::currentThread() == codeBase->thread() )
+        return true;
+    QCSAWorkerPool::rejectOperation("Cannot " + operation + " from a worker. The code base is read only for workers.");
+    return false;
+}
+
+}// namespace
+
 QCodeBase::QCodeBase(
         const char* const* translationUnitArgs,
         int                translationUnitNumArgs,
@@ -48,19 +228,65 @@ QCodeBase::QCodeBase(
     , d_ptr(new QCodeBasePrivate)
     , m_projectDir(searchDir != "" ? QDir(searchDir).path() : "")
     , m_root(0)
-    , m_current(0){
+    , m_current(0)
+    , m_precompiledHeader(0)
+    , m_precompiledHeaderArgIndex(-1)
+    , m_deferSave(false)
+    , m_savePending(false)
+    , m_holdSave(false)
+    , m_editOutput(0)
+    , m_parseOptions(DefaultParseOptions)
+    , m_translationUnitCache(0){
+
+    initialize(translationUnitArgs, translationUnitNumArgs, entries);
+}
 
+QCodeBase::QCodeBase(
+        const char* const*                translationUnitArgs,
+        int                               translationUnitNumArgs,
+        const QStringList&                entries,
+        const QHash<QString, QByteArray>& unsavedContents,
+        ParseOptions                      parseOptions,
+        const QStringList&                precompiledHeaders,
+        const QString&                    searchDir,
+        QObject*                          parent)
+
+    : QObject(parent)
+    , d_ptr(new QCodeBasePrivate)
+    , m_projectDir(searchDir != "" ? QDir(searchDir).path() : "")
+    , m_root(0)
+    , m_current(0)
+    , m_precompiledHeader(0)
+    , m_precompiledHeaderArgIndex(-1)
+    , m_deferSave(false)
+    , m_savePending(false)
+    , m_holdSave(false)
+    , m_editOutput(0)
+    , m_parseOptions(parseOptions)
+    , m_translationUnitCache(0){
+
+    for ( QHash<QString, QByteArray>::const_iterator it = unsavedContents.begin(); it != unsavedContents.end(); ++it )
+        m_unsavedContents[inclusionKey(it.key())] = it.value();
+
+    initialize(translationUnitArgs, translationUnitNumArgs, entries, precompiledHeaders);
+}
+
+void QCodeBase::initialize(
+        const char* const* translationUnitArgs,
+        int translationUnitNumArgs,
+        const QStringList& entries,
+        const QStringList& precompiledHeaders)
+{
     Q_D(QCodeBase);
 
-    m_sourceSearchPatterns << "*.c" << "*.C" << "*.cxx" << "*.cpp" << "*.c++" << "*.cc" << "*.cp";
+    m_sourceSearchPatterns << defaultSourceSearchPatterns();
     m_headerSearchPatterns << "*.h" << "*.H" << "*.hxx" << "*.hpp" << "*.h++" << "*.hh" << "*.hp";
 
     m_translationUnitNumArgs = translationUnitNumArgs;
     m_translationUnitArgs    = new char*[m_translationUnitNumArgs];
 
     for ( int i = 0 ;i < m_translationUnitNumArgs; ++i ){
-        m_translationUnitArgs[i] = new char[strlen(translationUnitArgs[i]) + 1];
-        strcpy(m_translationUnitArgs[i], translationUnitArgs[i]);
+        m_translationUnitArgs[i] = copyArgument(translationUnitArgs[i]);
     }
 
     if ( m_projectDir == "" ){
@@ -76,6 +302,11 @@ QCodeBase::QCodeBase(
 
     d->index = clang_createIndex(0, 0);
 
+    if ( !precompiledHeaders.isEmpty() )
+        m_precompiledHeader = new QPrecompiledHeader(precompiledHeaders, m_projectDir);
+    if ( m_parseOptions & CachedTranslationUnits )
+        m_translationUnitCache = new QTranslationUnitCache;
+
     for ( QStringList::const_iterator it = entries.begin(); it != entries.end(); ++it ){
         parsePath(*it);
     }
@@ -86,26 +317,104 @@ QCodeBase::~QCodeBase(){
         delete [] m_translationUnitArgs[i];
     }
     delete[] m_translationUnitArgs;
+    delete m_precompiledHeader;
+    delete m_translationUnitCache;
     delete d_ptr;
 }
 
 void QCodeBase::save(){
-    QString currentSelection     = m_current ? m_current->breadcrumbs() : "*";
-    QString currentSelectionType = m_current ? m_current->typeName() : "";
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( !isOwnerThread(this, "save files") )
+        return;
+
+    m_savePending = true;
+    if ( !m_deferSave )
+        flush();
+}
+
+void QCodeBase::discardModifiers(){
+    m_savePending = false;
+    for ( QList<ast::QASTFile*>::iterator it = m_files.begin(); it != m_files.end(); ++it ){
+        if ( (*it)->hasModifiers() )
+            (*it)->clearModifiers();
+    }
+}
+
+void QCodeBase::flush(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( !m_savePending || m_holdSave || !isOwnerThread(this, "save files") )
+        return;
+    m_savePending = false;
 
+    QCSAProfiler::PhaseScope profilerPhase(QCSAProfiler::Save);
+
+    QList<int> modifiedIndexes;
     for ( int i = 0; i < m_files.size(); ++i ){
-        QASTFile* root = m_files[i];
-        if ( root->hasModifiers() ){
-            root->save();
-            QCSAConsole::log(QCSAConsole::Info1, "Saved: " + root->identifier());
-            reparseIndex(i);
-        }
+        if ( m_files[i]->hasModifiers() )
+            modifiedIndexes.append(i);
     }
 
-    select(currentSelection, currentSelectionType);
+    reparseIndexes(affectedIndexes(modifiedIndexes));
+}
+
+int QCodeBase::reparseStaleFiles(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( !isOwnerThread(this, "reparse files") )
+        return 0;
+
+    flush();
+
+    // A changed precompiled header invalidates every translation unit using it, whether it was rebuilt or dropped
+    bool precompiledHeaderChanged = m_precompiledHeader && m_precompiledHeader->hasUserHeadersChanged();
+    if ( precompiledHeaderChanged )
+        updatePrecompiledHeader();
+
+    QList<int> staleIndexes;
+    for ( int i = 0; i < m_files.size(); ++i ){
+        if ( precompiledHeaderChanged || m_files[i]->isStale() )
+            staleIndexes.append(i);
+    }
+
+    reparseIndexes(staleIndexes);
+    return staleIndexes.size();
+}
+
+void QCodeBase::setUnsavedContent(const QString& file, const QByteArray& content){
+    QASTFile* root = findParsedFile(file);
+    if ( root ){
+        flush();
+        root->setUnsavedContent(content);
+        reparseIndexes(affectedIndexes(QList<int>() << m_files.indexOf(root)));
+    } else {
+        m_unsavedContents[inclusionKey(file)] = content;
+    }
+}
+
+void QCodeBase::setParseOptions(ParseOptions options){
+    m_parseOptions = options;
+    if ( (m_parseOptions & CachedTranslationUnits) && !m_translationUnitCache ){
+        m_translationUnitCache = new QTranslationUnitCache;
+    } else if ( !(m_parseOptions & CachedTranslationUnits) ){
+        delete m_translationUnitCache;
+        m_translationUnitCache = 0;
+    }
+}
+
+void QCodeBase::setDeferredSave(bool deferSave){
+    m_deferSave = deferSave;
+    if ( !m_deferSave )
+        flush();
+}
+
+void QCodeBase::setSaveHeld(bool holdSave){
+    m_holdSave = holdSave;
+    if ( !m_holdSave )
+        flush();
 }
 
 void QCodeBase::propagateUserCursor(int offset, const QString &file){
+    // The cursor is located within the tree pending saves are about to rebuild
+    flush();
     CXTranslationUnit transUnit = m_classifiers.first()->translationUnit();
     CXFile cfile = clang_getFile(transUnit, file.toStdString().c_str());
     CXSourceLocation sLocation = clang_getLocationForOffset(transUnit, cfile, offset);
@@ -113,6 +422,7 @@ void QCodeBase::propagateUserCursor(int offset, const QString &file){
 }
 
 void QCodeBase::propagateUserCursor(int line, int column, const QString &file){
+    flush();
     CXTranslationUnit transUnit = m_classifiers.first()->translationUnit();
     CXFile cfile = clang_getFile(transUnit, file.toStdString().c_str());
     CXSourceLocation sLocation = clang_getLocation(transUnit, cfile, line, column);
@@ -128,6 +438,12 @@ void QCodeBase::propagateUserCursor(const QSourceLocation &location){
 }
 
 bool QCodeBase::select(const QString &searchData, const QString &type){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QCSAProfiler::PhaseScope profilerPhase(QCSAProfiler::Find);
+    if ( !isOwnerThread(this, "select nodes") )
+        return false;
+
+    flush();
     for ( QList<ast::QASTFile*>::iterator it = m_files.begin(); it != m_files.end(); ++it ){
         QASTFile* file = *it;
         QASTNode* foundChild = file->findFirst(searchData, type);
@@ -140,6 +456,10 @@ bool QCodeBase::select(const QString &searchData, const QString &type){
 }
 
 bool QCodeBase::selectNode(QASTNode* node){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( !isOwnerThread(this, "select nodes") )
+        return false;
+
     if ( node != 0 ){
         m_current = node;
         emit nodeSelected(node);
@@ -149,6 +469,10 @@ bool QCodeBase::selectNode(QASTNode* node){
 }
 
 QList<QObject*> QCodeBase::find(const QString& searchData, const QString& type){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QCSAProfiler::PhaseScope profilerPhase(QCSAProfiler::Find);
+    flush();
+
     QList<QObject*> foundNodes;
 
     for ( QList<ast::QASTFile*>::iterator it = m_files.begin(); it != m_files.end(); ++it ){
@@ -161,6 +485,57 @@ QList<QObject*> QCodeBase::find(const QString& searchData, const QString& type){
     return foundNodes;
 }
 
+QList<QObject*> QCodeBase::nodesInRange(const QString& file, unsigned int fromLine, unsigned int toLine){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QCSAProfiler::PhaseScope profilerPhase(QCSAProfiler::Find);
+    flush();
+
+    QASTFile* astFile = findFile(file);
+    if ( !astFile ){
+        QCSAConsole::logError("Cannot query node range. File \'" + file + "\' has not been parsed.");
+        return QList<QObject*>();
+    }
+    if ( fromLine > toLine )
+        return QList<QObject*>();
+
+    CXTranslationUnit transUnit = classifierForFile(file)->translationUnit();
+
+    // The range ends right before the start of the line following toLine, or at the end of the file
+    QSourceLocation fromLocation = createSourceLocation(file, fromLine, 1, transUnit);
+    QSourceLocation toLocation   = createSourceLocation(file, toLine + 1, 1, transUnit);
+    unsigned int toOffset = toLocation.line() == toLine + 1 && toLocation.offset() > 0 ?
+                toLocation.offset() - 1 : astFile->rangeEndLocation()->offset();
+
+    return astFile->nodesInRange(fromLocation.offset(), toOffset);
+}
+
+QAnnotatedToken* QCodeBase::tokenAt(const QString& file, unsigned int offset){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    flush();
+    QTokenClassifier* classifier = classifierForFile(file);
+    if ( !classifier ){
+        QCSAConsole::logError("Cannot query token. File \'" + file + "\' has not been parsed.");
+        return 0;
+    }
+    return classifier->tokenAt(offset);
+}
+
+QList<QObject*> QCodeBase::tokensInRange(const QString& file, unsigned int from, unsigned int to){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    flush();
+    QTokenClassifier* classifier = classifierForFile(file);
+    if ( !classifier ){
+        QCSAConsole::logError("Cannot query token range. File \'" + file + "\' has not been parsed.");
+        return QList<QObject*>();
+    }
+
+    QList<QObject*> tokens;
+    QTokenClassifier::TokenVector foundTokens = classifier->tokensInRange(from, to);
+    for ( QTokenClassifier::TokenVector::iterator it = foundTokens.begin(); it != foundTokens.end(); ++it )
+        tokens.append(*it);
+    return tokens;
+}
+
 void QCodeBase::setHeaderSearchPattern(const QStringList &pattern){
     m_headerSearchPatterns = pattern;
 }
@@ -170,6 +545,7 @@ void QCodeBase::setSourceSearchPattern(const QStringList &pattern){
 }
 
 QASTFile *QCodeBase::findSource(const QString &header){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     QString headerBaseName = QFileInfo(header).baseName();
 
     QString searchLocation = m_projectDir;
@@ -191,6 +567,7 @@ QASTFile *QCodeBase::findSource(const QString &header){
 }
 
 QASTFile *QCodeBase::findHeader(const QString &source){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     QString sourceBaseName = QFileInfo(source).baseName();
 
     QString searchLocation = m_projectDir;
@@ -220,23 +597,172 @@ QTokenClassifier *QCodeBase::classifierForFile(const QString &file){
     return 0;
 }
 
-void QCodeBase::reparseIndex(int index){
+QList<int> QCodeBase::affectedIndexes(const QList<int>& changedIndexes) const{
+    QSet<int> affected;
+    for ( QList<int>::const_iterator it = changedIndexes.begin(); it != changedIndexes.end(); ++it ){
+        affected.insert(*it);
 
-    QASTFile* root               = m_files[index];
-    QTokenClassifier* classifier = m_classifiers[index];
-    CXTranslationUnit transUnit  = classifier->translationUnit();
+        QHash<QString, QList<ast::QASTFile*> >::const_iterator dependentsIt =
+            m_includedBy.find(inclusionKey(m_files[*it]->identifier()));
+        if ( dependentsIt == m_includedBy.end() )
+            continue;
 
-    emit fileAboutToBeReparsed(root);
+        for ( QList<ast::QASTFile*>::const_iterator depIt = dependentsIt->begin(); depIt != dependentsIt->end(); ++depIt )
+            affected.insert(m_files.indexOf(*depIt));
+    }
 
-    clang_reparseTranslationUnit(transUnit, 0, 0, clang_defaultReparseOptions(transUnit));
-    CXCursor startCursor = clang_getTranslationUnitCursor(transUnit);
-    classifier->reparse();
+    QList<int> result = affected.toList();
+    std::sort(result.begin(), result.end());
+    return result;
+}
 
-    root->removeChildren();
-    QASTVisitor::createCSANodeTree(startCursor, root, classifier);
-    root->reparseSize();
+QList<int> QCodeBase::translationUnitIndexes(const QList<int>& indexes) const{
+    QList<int> result;
+    for ( int i = 0; i < m_classifiers.size(); ++i ){
+        for ( QList<int>::const_iterator it = indexes.begin(); it != indexes.end(); ++it ){
+            if ( m_classifiers[*it]->translationUnit() == m_classifiers[i]->translationUnit() ){
+                result.append(i);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+void QCodeBase::setInclusions(QASTFile* root, const QStringList& inclusions){
+    QStringList previousInclusions = root->includedFiles();
+    for ( QStringList::const_iterator it = previousInclusions.begin(); it != previousInclusions.end(); ++it )
+        m_includedBy[inclusionKey(*it)].removeAll(root);
 
-    emit fileReparsed(root);
+    // Files built from a shared translation unit are part of its inclusions
+    QStringList rootInclusions = inclusions;
+    rootInclusions.removeAll(inclusionKey(root->identifier()));
+
+    root->setIncludedFiles(rootInclusions);
+    for ( QStringList::const_iterator it = rootInclusions.begin(); it != rootInclusions.end(); ++it )
+        m_includedBy[inclusionKey(*it)].append(root);
+}
+
+void QCodeBase::reparseIndexes(const QList<int>& changedIndexes){
+    QCSAProfiler::PhaseScope profilerPhase(QCSAProfiler::Reparse);
+    Q_D(QCodeBase);
+
+    if ( changedIndexes.isEmpty() )
+        return;
+
+    // All the files built from a translation unit are invalidated when it's reparsed
+    QList<int> indexes = translationUnitIndexes(changedIndexes);
+
+    QString currentSelection     = m_current ? m_current->breadcrumbs() : "*";
+    QString currentSelectionType = m_current ? m_current->typeName() : "";
+
+    QList<QPendingSave> pendingSaves;
+    for ( QList<int>::const_iterator it = indexes.begin(); it != indexes.end(); ++it ){
+        QASTFile* root = m_files[*it];
+        emit fileAboutToBeReparsed(root);
+
+        if ( root->hasModifiers() ){
+            // Edits are written in file order, and applied in memory instead of on disk
+            if ( m_editOutput )
+                root->saveEdits(m_editOutput);
+            else
+                pendingSaves.append(QPendingSave(root));
+        }
+    }
+
+    QUnsavedFiles unsavedFiles(m_files);
+    for ( QHash<QString, QByteArray>::const_iterator it = m_unsavedContents.begin(); it != m_unsavedContents.end(); ++it )
+        unsavedFiles.append(it.key(), it.value());
+
+    QList<QPendingReparse> pendingReparses;
+    for ( QList<int>::const_iterator it = indexes.begin(); it != indexes.end(); ++it ){
+        CXTranslationUnit transUnit = m_classifiers[*it]->translationUnit();
+
+        QList<QPendingReparse>::iterator pendingIt = pendingReparses.begin();
+        while ( pendingIt != pendingReparses.end() && pendingIt->transUnit != transUnit )
+            ++pendingIt;
+        if ( pendingIt == pendingReparses.end() ){
+            pendingIt = pendingReparses.insert(pendingIt, QPendingReparse(
+                transUnit,
+                &unsavedFiles,
+                d->index,
+                m_translationUnitArgs,
+                m_translationUnitNumArgs,
+                m_cachedTranslationUnits.contains(transUnit)
+            ));
+        }
+
+        pendingIt->indexes.append(*it);
+        pendingIt->roots.append(m_files[*it]);
+    }
+
+    // Files are written, then translation units reparsed in parallel, since a translation unit may include any of the
+    // other files. Node trees are rebuilt on this thread, in file order, since nodes are owned by the roots.
+    QtConcurrent::blockingMap(pendingSaves, writePendingFile);
+
+    // Files that failed to save keep their edits, which reloading them from disk would drop
+    for ( QList<QPendingSave>::const_iterator it = pendingSaves.begin(); it != pendingSaves.end(); ++it ){
+        if ( it->saved ){
+            QCSAConsole::log(QCSAConsole::Info1, "Saved: " + it->root->identifier());
+        } else {
+            QList<QPendingReparse>::iterator reparseIt;
+            for ( reparseIt = pendingReparses.begin(); reparseIt != pendingReparses.end(); ++reparseIt )
+                reparseIt->roots.removeOne(it->root);
+        }
+    }
+
+    QtConcurrent::blockingMap(pendingReparses, reparsePendingTranslationUnit);
+
+    for ( QList<QPendingReparse>::const_iterator it = pendingReparses.begin(); it != pendingReparses.end(); ++it ){
+        if ( it->reparseFailed ){
+            QCSAConsole::logError(
+                "Failed to reparse file: " + m_files[it->indexes.first()]->identifier() + ". Parsing it from scratch."
+            );
+        }
+        if ( !it->parsedTransUnit ){
+            QCSAConsole::logError("Failed to parse file: " + m_files[it->indexes.first()]->identifier());
+            continue;
+        }
+
+        rebuildTranslationUnit(it->indexes, it->parsedTransUnit);
+
+        // Units loaded from the cache, or that failed to reparse, are replaced once nothing refers to them anymore
+        if ( it->parsedTransUnit != it->transUnit ){
+            m_cachedTranslationUnits.remove(it->transUnit);
+            clang_disposeTranslationUnit(it->transUnit);
+        }
+    }
+
+    select(currentSelection, currentSelectionType);
+}
+
+void QCodeBase::rebuildTranslationUnit(const QList<int>& indexes, CXTranslationUnit transUnit){
+    std::vector<QASTNode*>         roots;
+    std::vector<QTokenClassifier*> classifiers;
+
+    for ( QList<int>::const_iterator it = indexes.begin(); it != indexes.end(); ++it ){
+        QASTFile* root               = m_files[*it];
+        QTokenClassifier* classifier = m_classifiers[*it];
+
+        classifier->reparse(transUnit, static_cast<unsigned int>(root->content().size()));
+        root->removeChildren();
+        if ( root->tokenSet()->translationUnit() != transUnit )
+            root->tokenSet()->reset(clang_getTranslationUnitCursor(transUnit), transUnit);
+
+        roots.push_back(root);
+        classifiers.push_back(classifier);
+    }
+
+    QASTVisitor::createCSANodeTrees(clang_getTranslationUnitCursor(transUnit), roots, classifiers);
+
+    QStringList inclusions = translationUnitInclusions(transUnit);
+    for ( QList<int>::const_iterator it = indexes.begin(); it != indexes.end(); ++it ){
+        QASTFile* root = m_files[*it];
+        root->reparseSize();
+        setInclusions(root, inclusions);
+
+        emit fileReparsed(root);
+    }
 }
 
 const QList<QASTFile*>& QCodeBase::astFiles() const{
@@ -244,6 +770,10 @@ const QList<QASTFile*>& QCodeBase::astFiles() const{
 }
 
 void QCodeBase::parsePath(const QString& path){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( !isOwnerThread(this, "parse files") )
+        return;
+
     QFileInfo finfo(path);
     if ( !finfo.exists() || finfo.isRelative() ){
         finfo = QFileInfo(m_projectDir + "/" + path);
@@ -253,11 +783,20 @@ void QCodeBase::parsePath(const QString& path){
         }
     }
     if ( finfo.isDir()){
-        QStringList searchVals = QStringList() << m_headerSearchPatterns << m_sourceSearchPatterns;
-        QDirIterator it(finfo.filePath(), searchVals, QDir::Files, QDirIterator::Subdirectories);
-        while (it.hasNext()){
-            it.next();
-            parseFile(it.filePath());
+        // With shared translation units sources go first, so headers are parsed on their own only if no source
+        // includes them
+        QList<QStringList> searchPasses;
+        if ( m_parseOptions & SharedTranslationUnits )
+            searchPasses << m_sourceSearchPatterns << m_headerSearchPatterns;
+        else
+            searchPasses << (QStringList() << m_headerSearchPatterns << m_sourceSearchPatterns);
+
+        for ( QList<QStringList>::const_iterator passIt = searchPasses.begin(); passIt != searchPasses.end(); ++passIt ){
+            QDirIterator it(finfo.filePath(), *passIt, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()){
+                it.next();
+                parseFile(it.filePath());
+            }
         }
     } else {
         parseFile(finfo.filePath());
@@ -265,8 +804,13 @@ void QCodeBase::parsePath(const QString& path){
 }
 
 QASTFile* QCodeBase::parseFile(const QString& file){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QCSAProfiler::PhaseScope profilerPhase(QCSAProfiler::Reparse);
     Q_D(QCodeBase);
 
+    if ( !isOwnerThread(this, "parse files") )
+        return 0;
+
     QFileInfo finfo(file);
     if (!finfo.exists() || finfo.isRelative()){
         finfo = QFileInfo(m_projectDir + "/" + file);
@@ -282,74 +826,245 @@ QASTFile* QCodeBase::parseFile(const QString& file){
 
     QString filePath = finfo.filePath();
 
-    CXTranslationUnit transUnit  = clang_parseTranslationUnit(
-                d->index,
-                filePath.toStdString().c_str(),
-                m_translationUnitArgs,
-                m_translationUnitNumArgs,
-                0,
-                0,
-                CXTranslationUnit_Incomplete | CXTranslationUnit_CXXChainedPCH);
+    if ( m_parseOptions & SharedTranslationUnits ){
+        QASTFile* parsedFile = findParsedFile(filePath);
+        if ( parsedFile )
+            return parsedFile;
+    }
 
-    CXCursor startCursor  = clang_getTranslationUnitCursor(transUnit);
-    CXFile   clangFile    = clang_getFile(transUnit, filePath.toStdString().c_str());
+    if ( m_precompiledHeader && m_precompiledHeaderArgIndex == -1 )
+        updatePrecompiledHeader();
 
-    QTokenClassifier* fileClassifier = new QTokenClassifier(transUnit, filePath.toStdString().c_str());
-    unsigned int fileSize = QTokenClassifier::getFileSize(filePath.toStdString().c_str());
+    QUnsavedFiles unsavedFiles(m_files);
+    for ( QHash<QString, QByteArray>::const_iterator it = m_unsavedContents.begin(); it != m_unsavedContents.end(); ++it )
+        unsavedFiles.append(it.key(), it.value());
 
-    QASTFile* fileRoot = new QASTFile(
-        new QAnnotatedTokenSet(startCursor, transUnit),
-        filePath,
-        new QSourceLocation(createSourceLocation(clang_getLocationForOffset(
-                transUnit,
-                clangFile,
-                fileSize
-            ))
-        )
-    );
-    fileRoot->setParent(this);
+    // Units are only cached while they match the files on disk
+    bool useCache = m_translationUnitCache && unsavedFiles.size() == 0;
 
-    m_files.append(fileRoot);
-    m_classifiers.append(fileClassifier);
+    CXTranslationUnit transUnit = 0;
+    if ( useCache ){
+        transUnit = m_translationUnitCache->load(d->index, filePath, m_translationUnitArgs, m_translationUnitNumArgs);
+        if ( transUnit )
+            m_cachedTranslationUnits.insert(transUnit);
+    }
 
-    QASTVisitor::createCSANodeTree(startCursor, fileRoot, fileClassifier);
+    if ( !transUnit ){
+        QDateTime parseStarted = QDateTime::currentDateTime();
+        transUnit = clang_parseTranslationUnit(
+                    d->index,
+                    filePath.toStdString().c_str(),
+                    m_translationUnitArgs,
+                    m_translationUnitNumArgs,
+                    unsavedFiles.data(),
+                    unsavedFiles.size(),
+                    translationUnitParseOptions);
+
+        if ( useCache && transUnit )
+            m_translationUnitCache->save(
+                transUnit, filePath, m_translationUnitArgs, m_translationUnitNumArgs, parseStarted
+            );
+    }
 
-    QCSAConsole::log(QCSAConsole::Info1, "Parsed: " + fileRoot->identifier());
-    emit fileAdded(fileRoot);
+    if ( !transUnit ){
+        QCSAConsole::logError("Failed to parse file: " + filePath);
+        return 0;
+    }
+
+    CXCursor startCursor   = clang_getTranslationUnitCursor(transUnit);
+    QStringList inclusions = translationUnitInclusions(transUnit);
 
+    // Project headers that weren't parsed yet get their trees from this translation unit as well
+    QStringList filePaths;
+    filePaths << filePath;
+    if ( m_parseOptions & SharedTranslationUnits ){
+        for ( QStringList::const_iterator it = inclusions.begin(); it != inclusions.end(); ++it ){
+            if ( isProjectHeader(*it) && !findParsedFile(*it) )
+                filePaths << *it;
+        }
+    }
+
+    std::vector<QASTNode*>         roots;
+    std::vector<QTokenClassifier*> classifiers;
+
+    for ( QStringList::const_iterator it = filePaths.begin(); it != filePaths.end(); ++it ){
+        QASTFile* fileRoot = new QASTFile(
+            new QAnnotatedTokenSet(startCursor, transUnit),
+            *it,
+            new QSourceLocation(*it, 0, 0, 0)
+        );
+        fileRoot->setParent(this);
+        loadContent(fileRoot);
+        fileRoot->reparseSize();
+
+        QTokenClassifier* fileClassifier = new QTokenClassifier(
+            transUnit, it->toStdString().c_str(), static_cast<unsigned int>(fileRoot->content().size())
+        );
+
+        m_files.append(fileRoot);
+        m_classifiers.append(fileClassifier);
+
+        roots.push_back(fileRoot);
+        classifiers.push_back(fileClassifier);
+    }
+
+    QASTVisitor::createCSANodeTrees(startCursor, roots, classifiers);
+
+    for ( std::vector<QASTNode*>::iterator it = roots.begin(); it != roots.end(); ++it ){
+        QASTFile* fileRoot = static_cast<QASTFile*>(*it);
+        setInclusions(fileRoot, inclusions);
+
+        QCSAConsole::log(QCSAConsole::Info1, "Parsed: " + fileRoot->identifier());
+        emit fileAdded(fileRoot);
+    }
+
+    QASTFile* fileRoot = static_cast<QASTFile*>(roots.front());
     if ( !m_current )
         selectNode(fileRoot);
 
     return fileRoot;
 }
 
-QASTFile* QCodeBase::reparseFile(QASTFile* file){
-    for ( int i = 0; i < m_files.size(); ++i ){
+bool QCodeBase::updatePrecompiledHeader(){
+    Q_D(QCodeBase);
 
-        if ( m_files[i] == file ){
+    int baseNumArgs = m_precompiledHeaderArgIndex == -1 ? m_translationUnitNumArgs : m_precompiledHeaderArgIndex;
+    if ( !m_precompiledHeader->update(d->index, m_translationUnitArgs, baseNumArgs) ){
+        // Files are parsed without the precompiled header from here on
+        QCSAConsole::logError("Precompiled header is not available, parsing common headers for each file.");
+        delete m_precompiledHeader;
+        m_precompiledHeader = 0;
+        removePrecompiledHeaderArgs();
+        return false;
+    }
 
-            QASTNode* currentFile = m_current;
-            while ( currentFile->astParent() )
-                currentFile = currentFile->astParent();
+    setPrecompiledHeaderArgs(m_precompiledHeader->path());
+    return true;
+}
 
-            QString currentSelection = "", currentSelectionType = "";
-            if ( qobject_cast<QASTFile*>(currentFile) == file ){
-                currentSelection     = m_current ? m_current->breadcrumbs() : "*";
-                currentSelectionType = m_current ? m_current->typeName() : "";
-            }
+void QCodeBase::setPrecompiledHeaderArgs(const QString& pchPath){
+    QByteArray pchPathData = pchPath.toLocal8Bit();
 
-            reparseIndex(i);
+    if ( m_precompiledHeaderArgIndex == -1 ){
+        char** translationUnitArgs = new char*[m_translationUnitNumArgs + 2];
+        for ( int i = 0; i < m_translationUnitNumArgs; ++i )
+            translationUnitArgs[i] = m_translationUnitArgs[i];
+        delete[] m_translationUnitArgs;
 
-            if ( currentFile == file )
-                select(currentSelection, currentSelectionType);
+        m_translationUnitArgs = translationUnitArgs;
+        m_precompiledHeaderArgIndex = m_translationUnitNumArgs;
+        m_translationUnitArgs[m_precompiledHeaderArgIndex] = copyArgument("-include-pch");
+        m_translationUnitNumArgs += 2;
+    } else {
+        delete[] m_translationUnitArgs[m_precompiledHeaderArgIndex + 1];
+    }
+    m_translationUnitArgs[m_precompiledHeaderArgIndex + 1] = copyArgument(pchPathData.constData());
+}
 
-            return file;
+void QCodeBase::removePrecompiledHeaderArgs(){
+    if ( m_precompiledHeaderArgIndex == -1 )
+        return;
+
+    delete[] m_translationUnitArgs[m_precompiledHeaderArgIndex];
+    delete[] m_translationUnitArgs[m_precompiledHeaderArgIndex + 1];
+    for ( int i = m_precompiledHeaderArgIndex + 2; i < m_translationUnitNumArgs; ++i )
+        m_translationUnitArgs[i - 2] = m_translationUnitArgs[i];
+    m_translationUnitNumArgs   -= 2;
+    m_precompiledHeaderArgIndex = -1;
+
+    // Reparsing keeps the arguments a unit was created with, so units using the header are parsed again instead
+    for ( QList<QTokenClassifier*>::const_iterator it = m_classifiers.begin(); it != m_classifiers.end(); ++it )
+        m_cachedTranslationUnits.insert((*it)->translationUnit());
+}
+
+QStringList QCodeBase::detectCommonHeaders(const QStringList& entries, const QString& searchDir){
+    QStringList sourceFiles;
+    for ( QStringList::const_iterator it = entries.begin(); it != entries.end(); ++it ){
+        QFileInfo finfo(*it);
+        if ( finfo.isRelative() && !searchDir.isEmpty() )
+            finfo = QFileInfo(searchDir + "/" + *it);
+
+        if ( finfo.isDir() ){
+            QDirIterator dirIt(finfo.filePath(), defaultSourceSearchPatterns(), QDir::Files, QDirIterator::Subdirectories);
+            while ( dirIt.hasNext() )
+                sourceFiles.append(dirIt.next());
+        } else if ( QDir::match(defaultSourceSearchPatterns(), finfo.fileName()) ){
+            sourceFiles.append(finfo.filePath());
         }
     }
+    return QPrecompiledHeader::detectCommonHeaders(sourceFiles);
+}
+
+// Reads the contents of each file in order, with a size of -1 reading the remaining input
+bool QCodeBase::readUnsavedContents(
+        QIODevice* input,
+        const QStringList& files,
+        const QList<int>& sizes,
+        QHash<QString, QByteArray>& contents)
+{
+    for ( int i = 0; i < files.size(); ++i ){
+        int size = sizes[i];
+        QByteArray content = size == -1 ? input->readAll() : input->read(size);
+        if ( size != -1 && content.size() != size ){
+            QCSAConsole::logError("Unexpected end of input for unsaved file: " + files[i]);
+            return false;
+        }
+        contents[files[i]] = content;
+    }
+    return true;
+}
+
+void QCodeBase::loadContent(QASTFile* root){
+    QCSAProfiler::PhaseScope profilerPhase(QCSAProfiler::FileIO);
+    QHash<QString, QByteArray>::iterator unsavedIt = m_unsavedContents.find(inclusionKey(root->identifier()));
+    if ( unsavedIt != m_unsavedContents.end() ){
+        root->setUnsavedContent(unsavedIt.value());
+        m_unsavedContents.erase(unsavedIt);
+    } else {
+        root->reloadContent();
+    }
+}
+
+QASTFile* QCodeBase::findParsedFile(const QString& path){
+    QString key = inclusionKey(path);
+    for ( QList<ast::QASTFile*>::const_iterator it = m_files.begin(); it != m_files.end(); ++it ){
+        if ( inclusionKey((*it)->identifier()) == key )
+            return *it;
+    }
     return 0;
 }
 
+bool QCodeBase::isProjectHeader(const QString& path) const{
+    return inclusionKey(path).startsWith(inclusionKey(m_projectDir) + "/") &&
+           QDir::match(m_headerSearchPatterns, QFileInfo(path).fileName());
+}
+
+QASTFile* QCodeBase::reparseFile(QASTFile* file){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( !isOwnerThread(this, "reparse files") )
+        return 0;
+
+    // Reparsing reloads the file contents, so pending saves need to be written first
+    flush();
+
+    int index = m_files.indexOf(file);
+    if ( index == -1 )
+        return 0;
+
+    if ( !file->isStale() ){
+        QCSAConsole::log(QCSAConsole::Info2, "Unchanged, skipped reparse: " + file->identifier());
+        return file;
+    }
+
+    reparseIndexes(QList<int>() << index);
+    return file;
+}
+
 QASTFile* QCodeBase::createFile(const QString& filePath){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( !isOwnerThread(this, "create files") )
+        return 0;
+
     QFile file(filePath);
     if ( !file.open(QIODevice::WriteOnly) ){
         QCSAConsole::logError("Cannot create file \'" + filePath + "\'.");
@@ -359,6 +1074,10 @@ QASTFile* QCodeBase::createFile(const QString& filePath){
 }
 
 bool QCodeBase::makePath(const QString& path){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( !isOwnerThread(this, "create paths") )
+        return false;
+
     QDir dir(path);
     if ( dir.isRelative() && m_projectDir == ""){
         QCSAConsole::logError(
@@ -373,6 +1092,7 @@ bool QCodeBase::makePath(const QString& path){
 }
 
 QASTFile *QCodeBase::findFile(const QString &fileName){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     for ( QList<ast::QASTFile*>::const_iterator it = m_files.begin(); it != m_files.end(); ++it ){
         ast::QASTFile* file = *it;
         if ( file->identifier() == fileName )
@@ -382,6 +1102,7 @@ QASTFile *QCodeBase::findFile(const QString &fileName){
 }
 
 QSourceLocation* QCodeBase::createLocation(const QString& file, unsigned int lineOrOffset, unsigned int column){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     for ( int i = 0; i < m_files.size(); ++i ){
         if ( m_files[i]->identifier() == file ){
             return m_files[i]->createLocation(lineOrOffset, column);
@@ -390,7 +1111,17 @@ QSourceLocation* QCodeBase::createLocation(const QString& file, unsigned int lin
     return 0;
 }
 
+QVariantMap QCodeBase::profile() const{
+    if ( !QCSAProfiler::isEnabled() )
+        QCSAConsole::log(QCSAConsole::Warning, "Profiling is disabled, the profile will be empty.");
+    return QCSAProfiler::instance().toJson().toVariantMap();
+}
+
 void QCodeBase::setProjectDir(const QString& path){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    if ( !isOwnerThread(this, "change the project directory") )
+        return;
+
     QDir dir(path);
     if ( dir.isAbsolute() )
         m_projectDir = dir.path();
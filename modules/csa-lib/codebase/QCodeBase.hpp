@@ -19,22 +19,37 @@
 #define QCODEBASE_HPP
 
 #include <QObject>
+#include <QHash>
+#include <QSet>
 #include <QtScript>
 
 #include "QCSAGlobal.hpp"
 #include "QASTNode.hpp"
 #include "QASTFile.hpp"
+#include "QAnnotatedToken.hpp"
 
 namespace csa{
 
 class QTokenClassifier;
 class QSourceLocation;
+class QPrecompiledHeader;
+class QTranslationUnitCache;
 
 class QCodeBasePrivate;
 class Q_CSA_EXPORT QCodeBase : public QObject{
 
     Q_OBJECT
 
+public:
+    enum ParseOption{
+        DefaultParseOptions    = 0x0,
+        // Project headers get their trees from the translation units of the sources including them
+        SharedTranslationUnits = 0x1,
+        // Translation units are saved to a cache directory, and loaded back while their files are unchanged
+        CachedTranslationUnits = 0x2
+    };
+    Q_DECLARE_FLAGS(ParseOptions, ParseOption)
+
 public:
     explicit QCodeBase(
             const char* const* translationUnitArgs,
@@ -42,6 +57,15 @@ public:
             const QStringList& entries,
             const QString&     searchDir = "",
             QObject*           parent = 0);
+    QCodeBase(
+            const char* const*                translationUnitArgs,
+            int                               translationUnitNumArgs,
+            const QStringList&                entries,
+            const QHash<QString, QByteArray>& unsavedContents,
+            ParseOptions                      parseOptions = DefaultParseOptions,
+            const QStringList&                precompiledHeaders = QStringList(),
+            const QString&                    searchDir = "",
+            QObject*                          parent = 0);
     ~QCodeBase();
 
     void propagateUserCursor(int offset, const QString& file);
@@ -53,10 +77,36 @@ public:
 
     const QList<csa::ast::QASTFile*>& astFiles() const;
 
+    void setDeferredSave(bool deferSave);
+    bool isSaveDeferred() const;
+
+    void setSaveHeld(bool holdSave);
+    bool isSaveHeld() const;
+
+    void discardModifiers();
+
+    void setEditOutput(QIODevice* output);
+    QIODevice* editOutput() const;
+
+    void setUnsavedContent(const QString& file, const QByteArray& content);
+
+    void setParseOptions(ParseOptions options);
+    ParseOptions parseOptions() const;
+
+    const csa::QPrecompiledHeader* precompiledHeader() const;
+
+    static QStringList detectCommonHeaders(const QStringList& entries, const QString& searchDir = "");
+    static bool readUnsavedContents(
+            QIODevice*                  input,
+            const QStringList&          files,
+            const QList<int>&           sizes,
+            QHash<QString, QByteArray>& contents);
+
 public slots:
     csa::QSourceLocation* createLocation(const QString &file, unsigned int lineOrOffset, unsigned int column);
 
     void save();
+    void flush();
 
     bool select(const QString &searchData, const QString &type = "");
     bool selectNode(csa::ast::QASTNode* node);
@@ -64,14 +114,20 @@ public slots:
 
     void setProjectDir(const QString& path);
     QList<QObject*> find(const QString& searchData, const QString& type = "");
+    QList<QObject*> nodesInRange(const QString& file, unsigned int fromLine, unsigned int toLine);
+    csa::QAnnotatedToken* tokenAt(const QString& file, unsigned int offset);
+    QList<QObject*> tokensInRange(const QString& file, unsigned int from, unsigned int to);
     csa::ast::QASTFile* findFile(const QString& fileName);
     csa::ast::QASTFile* findSource(const QString& headerFile);
     csa::ast::QASTFile* findHeader(const QString& sourceFile);
     QList<QObject*> files() const;
 
+    QVariantMap profile() const;
+
     void parsePath(const QString& path);
     csa::ast::QASTFile* parseFile(const QString& file);
     csa::ast::QASTFile* reparseFile(csa::ast::QASTFile* file);
+    int reparseStaleFiles();
     csa::ast::QASTFile* createFile(const QString& filePath);
     bool makePath(const QString& path);
 
@@ -91,8 +147,26 @@ private:
     Q_DECLARE_PRIVATE(QCodeBase)
 
 
+    void initialize(
+        const char* const* translationUnitArgs,
+        int translationUnitNumArgs,
+        const QStringList& entries,
+        const QStringList& precompiledHeaders = QStringList());
+
+    bool updatePrecompiledHeader();
+    void setPrecompiledHeaderArgs(const QString& pchPath);
+    void removePrecompiledHeaderArgs();
+
     csa::QTokenClassifier* classifierForFile(const QString& file);
-    void reparseIndex(int index);
+    void reparseIndexes(const QList<int>& indexes);
+    void rebuildTranslationUnit(const QList<int>& indexes, CXTranslationUnit transUnit);
+    QList<int> affectedIndexes(const QList<int>& changedIndexes) const;
+    QList<int> translationUnitIndexes(const QList<int>& indexes) const;
+    void setInclusions(csa::ast::QASTFile* root, const QStringList& inclusions);
+
+    void loadContent(csa::ast::QASTFile* root);
+    csa::ast::QASTFile* findParsedFile(const QString& path);
+    bool isProjectHeader(const QString& path) const;
 
 private:
     QList<ast::QASTFile*>  m_files;
@@ -106,18 +180,72 @@ private:
     int                    m_translationUnitNumArgs;
     char**                 m_translationUnitArgs;
 
+    // Common headers built once, added to the translation unit arguments as '-include-pch <path>' starting at the
+    // given index
+    csa::QPrecompiledHeader* m_precompiledHeader;
+    int                    m_precompiledHeaderArgIndex;
+
     QList<csa::QTokenClassifier*> m_classifiers;
+
+    bool                   m_deferSave;
+    bool                   m_savePending;
+
+    // Pending saves are kept until released, even by functions that flush before reading the tree
+    bool                   m_holdSave;
+
+    QIODevice*             m_editOutput;
+
+    // Contents of files not parsed yet, keyed by their clean absolute path
+    QHash<QString, QByteArray> m_unsavedContents;
+
+    ParseOptions           m_parseOptions;
+    csa::QTranslationUnitCache* m_translationUnitCache;
+
+    // Translation units loaded from the cache, or built with a precompiled header that was dropped since, which are
+    // parsed again instead of being reparsed
+    QSet<CXTranslationUnit> m_cachedTranslationUnits;
+
+    // Files whose translation units include the file at the given path
+    QHash<QString, QList<csa::ast::QASTFile*> > m_includedBy;
 };
 
 
 inline QList<QObject*> QCodeBase::files() const{
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return QObject::children();
 }
 
 inline csa::ast::QASTNode* QCodeBase::selectedNode(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
     return m_current;
 }
 
+inline bool QCodeBase::isSaveDeferred() const{
+    return m_deferSave;
+}
+
+inline bool QCodeBase::isSaveHeld() const{
+    return m_holdSave;
+}
+
+inline QCodeBase::ParseOptions QCodeBase::parseOptions() const{
+    return m_parseOptions;
+}
+
+inline const QPrecompiledHeader* QCodeBase::precompiledHeader() const{
+    return m_precompiledHeader;
+}
+
+inline void QCodeBase::setEditOutput(QIODevice* output){
+    m_editOutput = output;
+}
+
+inline QIODevice* QCodeBase::editOutput() const{
+    return m_editOutput;
+}
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(QCodeBase::ParseOptions)
+
 } // namespace
 
 #endif // QCODEBASE_HPP
@@ -0,0 +1,188 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#include "QDependencyManifest.hpp"
+#include <QFile>
+#include <QFileInfo>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+namespace csa{
+
+namespace{
+
+QByteArray fileHash(const QString& path){
+    QFile file(path);
+    if ( !file.open(QIODevice::ReadOnly) )
+        return QByteArray();
+    return QCryptographicHash::hash(file.readAll(), QCryptographicHash::Md5);
+}
+
+class QDependencyCollector{
+public:
+    QDependencyCollector(CXTranslationUnit pTransUnit) : transUnit(pTransUnit){}
+
+    CXTranslationUnit transUnit;
+    QStringList       paths;
+    QStringList       systemPaths;
+};
+
+// Collects the main file as well, since it's reported with an empty include stack
+void collectDependency(CXFile includedFile, CXSourceLocation*, unsigned int, CXClientData data){
+    QDependencyCollector* collector = static_cast<QDependencyCollector*>(data);
+
+    CXString fileName = clang_getFileName(includedFile);
+    QString path = QString::fromUtf8(clang_getCString(fileName));
+    clang_disposeString(fileName);
+
+    if ( clang_Location_isInSystemHeader(clang_getLocationForOffset(collector->transUnit, includedFile, 0)) )
+        collector->systemPaths.append(path);
+    else
+        collector->paths.append(path);
+}
+
+}// namespace
+
+// QDependencyManifest::Dependency Definitions
+// -------------------------------------------
+
+QDependencyManifest::Dependency::Dependency(const QString& pPath, bool pIsSystem)
+    : path(pPath)
+    , size(-1)
+    , isSystem(pIsSystem)
+{
+    if ( !path.isEmpty() ){
+        QFileInfo info(path);
+        lastModified = info.lastModified();
+        size         = info.exists() ? info.size() : -1;
+        hash         = fileHash(path);
+    }
+}
+
+bool QDependencyManifest::Dependency::hasChanged() const{
+    QFileInfo info(path);
+    if ( !info.exists() )
+        return true;
+    if ( info.size() == size && info.lastModified() == lastModified )
+        return false;
+
+    // The file was touched, compare contents before reporting a change
+    return info.size() != size || fileHash(path) != hash;
+}
+
+// QDependencyManifest Definitions
+// -------------------------------
+
+QDependencyManifest::QDependencyManifest(){
+}
+
+QDependencyManifest::~QDependencyManifest(){
+}
+
+void QDependencyManifest::collect(CXTranslationUnit transUnit, const QDateTime& buildStarted){
+    m_dependencies.clear();
+
+    QDependencyCollector collector(transUnit);
+    clang_getInclusions(transUnit, collectDependency, &collector);
+    collector.paths.removeDuplicates();
+    collector.systemPaths.removeDuplicates();
+
+    for ( QStringList::const_iterator it = collector.paths.begin(); it != collector.paths.end(); ++it )
+        m_dependencies.append(Dependency(*it));
+    for ( QStringList::const_iterator it = collector.systemPaths.begin(); it != collector.systemPaths.end(); ++it )
+        m_dependencies.append(Dependency(*it, true));
+
+    for ( QList<Dependency>::iterator it = m_dependencies.begin(); it != m_dependencies.end(); ++it ){
+        if ( it->lastModified > buildStarted ){
+            it->size = -1;
+            it->hash.clear();
+        }
+    }
+}
+
+void QDependencyManifest::clear(){
+    m_dependencies.clear();
+}
+
+bool QDependencyManifest::hasChanged() const{
+    if ( m_dependencies.isEmpty() )
+        return true;
+    for ( QList<Dependency>::const_iterator it = m_dependencies.begin(); it != m_dependencies.end(); ++it ){
+        if ( it->hasChanged() )
+            return true;
+    }
+    return false;
+}
+
+bool QDependencyManifest::hasUserFilesChanged() const{
+    if ( m_dependencies.isEmpty() )
+        return true;
+    for ( QList<Dependency>::const_iterator it = m_dependencies.begin(); it != m_dependencies.end(); ++it ){
+        if ( !it->isSystem && it->hasChanged() )
+            return true;
+    }
+    return false;
+}
+
+bool QDependencyManifest::read(const QString& manifestPath){
+    m_dependencies.clear();
+
+    QFile file(manifestPath);
+    if ( !file.open(QIODevice::ReadOnly) )
+        return false;
+
+    QJsonArray dependencies = QJsonDocument::fromJson(file.readAll()).object()["dependencies"].toArray();
+    for ( QJsonArray::const_iterator it = dependencies.begin(); it != dependencies.end(); ++it ){
+        QJsonObject dependencyObject = (*it).toObject();
+
+        Dependency dependency;
+        dependency.path         = dependencyObject["path"].toString();
+        dependency.size         = static_cast<qint64>(dependencyObject["size"].toDouble());
+        dependency.lastModified = QDateTime::fromMSecsSinceEpoch(
+            static_cast<qint64>(dependencyObject["lastModified"].toDouble())
+        );
+        dependency.hash         = QByteArray::fromHex(dependencyObject["hash"].toString().toLatin1());
+        dependency.isSystem     = dependencyObject["system"].toBool();
+        m_dependencies.append(dependency);
+    }
+    return !m_dependencies.isEmpty();
+}
+
+bool QDependencyManifest::write(const QString& manifestPath) const{
+    QJsonArray dependencies;
+    for ( QList<Dependency>::const_iterator it = m_dependencies.begin(); it != m_dependencies.end(); ++it ){
+        QJsonObject dependencyObject;
+        dependencyObject["path"]         = it->path;
+        dependencyObject["size"]         = static_cast<double>(it->size);
+        dependencyObject["lastModified"] = static_cast<double>(it->lastModified.toMSecsSinceEpoch());
+        dependencyObject["hash"]         = QString::fromLatin1(it->hash.toHex());
+        dependencyObject["system"]       = it->isSystem;
+        dependencies.append(dependencyObject);
+    }
+
+    QJsonObject manifest;
+    manifest["dependencies"] = dependencies;
+
+    QFile file(manifestPath);
+    if ( !file.open(QIODevice::WriteOnly) )
+        return false;
+    return file.write(QJsonDocument(manifest).toJson()) != -1;
+}
+
+}// namespace
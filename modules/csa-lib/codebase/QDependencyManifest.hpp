@@ -0,0 +1,73 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#ifndef QDEPENDENCYMANIFEST_HPP
+#define QDEPENDENCYMANIFEST_HPP
+
+#include "clang-c/Index.h"
+#include "QCSAGlobal.hpp"
+#include <QStringList>
+#include <QDateTime>
+#include <QByteArray>
+#include <QList>
+
+namespace csa{
+
+// Files a cached libclang artifact was built from, together with their size, modification time and hash. The
+// manifest is stored as json next to the artifact, and is used to tell whether the artifact is still valid.
+class Q_CSA_EXPORT QDependencyManifest{
+
+public:
+    QDependencyManifest();
+    ~QDependencyManifest();
+
+    // Dependencies are only known once the artifact is built. The ones modified after the build started may have been
+    // read in either version, so they are recorded as changed.
+    void collect(CXTranslationUnit transUnit, const QDateTime& buildStarted);
+    void clear();
+
+    bool isEmpty() const;
+    bool hasChanged() const;
+    bool hasUserFilesChanged() const;
+
+    bool read(const QString& manifestPath);
+    bool write(const QString& manifestPath) const;
+
+private:
+    class Dependency{
+    public:
+        explicit Dependency(const QString& pPath = "", bool pIsSystem = false);
+
+        bool hasChanged() const;
+
+        QString    path;
+        qint64     size;
+        QDateTime  lastModified;
+        QByteArray hash;
+        bool       isSystem;
+    };
+
+    QList<Dependency> m_dependencies;
+};
+
+inline bool QDependencyManifest::isEmpty() const{
+    return m_dependencies.isEmpty();
+}
+
+}// namespace
+
+#endif // QDEPENDENCYMANIFEST_HPP
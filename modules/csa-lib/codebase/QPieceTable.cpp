@@ -0,0 +1,278 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#include "QPieceTable.hpp"
+#include <QIODevice>
+#include <algorithm>
+
+namespace csa{
+
+QPieceTable::QPieceTable(const QByteArray& original)
+    : m_totalInsertions(0)
+    , m_totalErasures(0)
+    , m_positionIndexValid(false)
+{
+    reset(original);
+}
+
+QPieceTable::~QPieceTable(){
+}
+
+void QPieceTable::reset(const QByteArray& original){
+    m_original = original;
+    m_added.clear();
+    m_spans.clear();
+    m_insertions.clear();
+    m_totalInsertions = 0;
+    m_totalErasures   = 0;
+    m_positionIndexValid = false;
+
+    if ( m_original.size() > 0 )
+        m_spans.insert(std::make_pair(0u, originalSize()));
+}
+
+void QPieceTable::insert(unsigned int offset, const QByteArray& data){
+    // Insertions at the same offset keep the order they were added in
+    m_insertions.insert(std::make_pair(offset, Piece(static_cast<unsigned int>(m_added.size()), static_cast<unsigned int>(data.size()))));
+    m_added.append(data);
+    ++m_totalInsertions;
+    m_positionIndexValid = false;
+}
+
+void QPieceTable::erase(unsigned int from, unsigned int to){
+    if ( from >= to )
+        return;
+
+    // Split the span overlapping the start of the range
+    SpanMap::iterator it = m_spans.upper_bound(from);
+    if ( it != m_spans.begin() ){
+        --it;
+        if ( it->first < from && it->second > from ){
+            unsigned int spanEnd = it->second;
+            it->second = from;
+            m_spans.insert(std::make_pair(from, spanEnd));
+        }
+    }
+
+    // Remove the spans within the range, keeping whatever exceeds it
+    it = m_spans.lower_bound(from);
+    while ( it != m_spans.end() && it->first < to ){
+        unsigned int spanEnd = it->second;
+        m_spans.erase(it++);
+        if ( spanEnd > to ){
+            m_spans.insert(std::make_pair(to, spanEnd));
+            break;
+        }
+    }
+
+    ++m_totalErasures;
+    m_positionIndexValid = false;
+}
+
+unsigned int QPieceTable::modifiedSize() const{
+    if ( !isModified() )
+        return originalSize();
+
+    const PositionIndex& index = positionIndex();
+    return index.empty() ? 0 : index.back().modified + index.back().length;
+}
+
+unsigned int QPieceTable::modifiedOffset(unsigned int originalOffset) const{
+    if ( !isModified() )
+        return originalOffset;
+
+    // Insertions anchored at the offset are placed before the original data found there
+    const PositionIndex& index = positionIndex();
+    PositionIndex::const_iterator it = std::upper_bound(index.begin(), index.end(), originalOffset, originalOffsetBefore);
+    if ( it == index.begin() )
+        return 0;
+
+    --it;
+    if ( !it->inserted && originalOffset < it->original + it->length )
+        return it->modified + (originalOffset - it->original);
+    return it->modified + it->length;
+}
+
+unsigned int QPieceTable::originalOffset(unsigned int modifiedOffset) const{
+    if ( !isModified() )
+        return modifiedOffset;
+
+    // Offsets within inserted data resolve to the insertion anchor
+    const PositionIndex& index = positionIndex();
+    PositionIndex::const_iterator it = std::upper_bound(index.begin(), index.end(), modifiedOffset, modifiedOffsetBefore);
+    if ( it == index.begin() )
+        return 0;
+
+    --it;
+    if ( it->inserted )
+        return it->original;
+    if ( modifiedOffset < it->modified + it->length )
+        return it->original + (modifiedOffset - it->modified);
+    return it->original + it->length;
+}
+
+bool QPieceTable::originalOffsetBefore(unsigned int offset, const PositionEntry& entry){
+    return offset < entry.original;
+}
+
+bool QPieceTable::modifiedOffsetBefore(unsigned int offset, const PositionEntry& entry){
+    return offset < entry.modified;
+}
+
+QPieceTable::EditList QPieceTable::edits() const{
+    EditList result;
+    if ( !isModified() )
+        return result;
+
+    // Erased ranges and the insertions anchored within or right after them merge into a single edit
+    const PositionIndex& index = positionIndex();
+    unsigned int originalPosition = 0;
+    QByteArray replacement;
+
+    for ( PositionIndex::const_iterator it = index.begin(); it != index.end(); ++it ){
+        if ( it->inserted ){
+            replacement.append(m_added.constData() + it->added, static_cast<int>(it->length));
+        } else {
+            if ( it->original > originalPosition || !replacement.isEmpty() ){
+                result.push_back(Edit(originalPosition, it->original, replacement));
+                replacement.clear();
+            }
+            originalPosition = it->original + it->length;
+        }
+    }
+
+    if ( originalPosition < originalSize() || !replacement.isEmpty() )
+        result.push_back(Edit(originalPosition, originalSize(), replacement));
+
+    return result;
+}
+
+void QPieceTable::buildPositionIndex() const{
+    if ( isModified() )
+        positionIndex();
+}
+
+const QPieceTable::PositionIndex& QPieceTable::positionIndex() const{
+    if ( m_positionIndexValid )
+        return m_positionIndex;
+
+    m_positionIndex.clear();
+
+    SpanMap::const_iterator spanIt           = m_spans.begin();
+    InsertionMap::const_iterator insertionIt = m_insertions.begin();
+
+    unsigned int spanPosition     = spanIt != m_spans.end() ? spanIt->first : 0;
+    unsigned int modifiedPosition = 0;
+
+    while ( spanIt != m_spans.end() || insertionIt != m_insertions.end() ){
+        if ( insertionIt != m_insertions.end() && ( spanIt == m_spans.end() || insertionIt->first <= spanPosition ) ){
+            const Piece& piece = insertionIt->second;
+            m_positionIndex.push_back(
+                PositionEntry(insertionIt->first, modifiedPosition, piece.length, true, piece.start));
+            modifiedPosition += piece.length;
+            ++insertionIt;
+        } else {
+            unsigned int chunkEnd = spanIt->second;
+            if ( insertionIt != m_insertions.end() && insertionIt->first < chunkEnd )
+                chunkEnd = insertionIt->first;
+
+            m_positionIndex.push_back(PositionEntry(spanPosition, modifiedPosition, chunkEnd - spanPosition));
+            modifiedPosition += chunkEnd - spanPosition;
+
+            if ( chunkEnd == spanIt->second ){
+                ++spanIt;
+                if ( spanIt != m_spans.end() )
+                    spanPosition = spanIt->first;
+            } else {
+                spanPosition = chunkEnd;
+            }
+        }
+    }
+
+    m_positionIndexValid = true;
+    return m_positionIndex;
+}
+
+QByteArray QPieceTable::read(unsigned int from, unsigned int to) const{
+    QByteArray result;
+    if ( from < to )
+        outputRange(from, to, &result, 0);
+    return result;
+}
+
+QByteArray QPieceTable::readAll() const{
+    if ( !isModified() )
+        return m_original;
+
+    QByteArray result;
+    outputRange(0, originalSize() + 1, &result, 0);
+    return result;
+}
+
+bool QPieceTable::write(QIODevice* device) const{
+    return outputRange(0, originalSize() + 1, 0, device);
+}
+
+bool QPieceTable::outputRange(unsigned int from, unsigned int to, QByteArray* buffer, QIODevice* device) const{
+    SpanMap::const_iterator spanIt = m_spans.upper_bound(from);
+    if ( spanIt != m_spans.begin() ){
+        --spanIt;
+        if ( spanIt->second <= from )
+            ++spanIt;
+    }
+
+    InsertionMap::const_iterator insertionIt = m_insertions.lower_bound(from);
+    unsigned int position = from;
+
+    while ( true ){
+        bool hasInsertion = insertionIt != m_insertions.end() && insertionIt->first < to;
+        unsigned int next = hasInsertion ? insertionIt->first : to;
+
+        // Output the kept original data up to the next insertion
+        while ( spanIt != m_spans.end() && spanIt->first < next ){
+            unsigned int start = spanIt->first > position ? spanIt->first : position;
+            unsigned int end   = spanIt->second < next ? spanIt->second : next;
+            if ( start < end && !output(m_original.constData() + start, end - start, buffer, device) )
+                return false;
+
+            if ( spanIt->second > next )
+                break;
+            ++spanIt;
+        }
+        position = next;
+
+        if ( !hasInsertion )
+            break;
+
+        const Piece& piece = insertionIt->second;
+        if ( !output(m_added.constData() + piece.start, piece.length, buffer, device) )
+            return false;
+        ++insertionIt;
+    }
+
+    return true;
+}
+
+bool QPieceTable::output(const char* data, unsigned int length, QByteArray* buffer, QIODevice* device){
+    if ( buffer )
+        buffer->append(data, length);
+    if ( device )
+        return device->write(data, length) == static_cast<qint64>(length);
+    return true;
+}
+
+}// namespace
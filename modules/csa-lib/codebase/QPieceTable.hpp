@@ -0,0 +1,150 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#ifndef QPIECETABLE_HPP
+#define QPIECETABLE_HPP
+
+#include "QCSAGlobal.hpp"
+#include <QByteArray>
+#include <map>
+#include <vector>
+
+class QIODevice;
+
+namespace csa{
+
+// Edit buffer over the original contents of a file. Kept parts of the original buffer are stored as spans ordered by
+// their offset, while inserted data is appended to a separate buffer and anchored at an offset in the original one.
+// Offsets are always expressed in the original buffer, so edits can be queued in any order.
+class Q_CSA_EXPORT QPieceTable{
+
+public:
+    // Replacement of the original bytes in [from, to)
+    class Edit{
+    public:
+        Edit(unsigned int pFrom, unsigned int pTo, const QByteArray& pReplacement)
+            : from(pFrom), to(pTo), replacement(pReplacement){}
+
+        unsigned int from;
+        unsigned int to;
+        QByteArray   replacement;
+    };
+
+    typedef std::vector<Edit> EditList;
+
+public:
+    explicit QPieceTable(const QByteArray& original = QByteArray());
+    ~QPieceTable();
+
+    void reset(const QByteArray& original);
+
+    void insert(unsigned int offset, const QByteArray& data);
+    void erase(unsigned int from, unsigned int to);
+
+    bool isModified() const;
+    int  totalInsertions() const;
+    int  totalErasures() const;
+
+    unsigned int originalSize() const;
+    unsigned int modifiedSize() const;
+
+    unsigned int modifiedOffset(unsigned int originalOffset) const;
+    unsigned int originalOffset(unsigned int modifiedOffset) const;
+
+    QByteArray read(unsigned int from, unsigned int to) const;
+    QByteArray readAll() const;
+    bool write(QIODevice* device) const;
+
+    EditList edits() const;
+
+    // Builds the position index ahead of the first query, so threads that only read the table never write to it
+    void buildPositionIndex() const;
+
+private:
+    // prevent copy
+    QPieceTable(const QPieceTable& other);
+    QPieceTable& operator=(const QPieceTable& other);
+
+    class Piece{
+    public:
+        Piece(unsigned int pStart, unsigned int pLength) : start(pStart), length(pLength){}
+
+        unsigned int start;
+        unsigned int length;
+    };
+
+    // Piece of the modified buffer, with its position in both the original and the modified buffer. Inserted pieces
+    // have their anchor as original position, and their data starts at the added position.
+    class PositionEntry{
+    public:
+        PositionEntry(
+                unsigned int pOriginal, unsigned int pModified, unsigned int pLength,
+                bool pInserted = false, unsigned int pAdded = 0)
+            : original(pOriginal), modified(pModified), length(pLength), added(pAdded), inserted(pInserted){}
+
+        unsigned int original;
+        unsigned int modified;
+        unsigned int length;
+        unsigned int added;
+        bool         inserted;
+    };
+
+    typedef std::map<unsigned int, unsigned int> SpanMap;
+    typedef std::multimap<unsigned int, Piece>   InsertionMap;
+    typedef std::vector<PositionEntry>           PositionIndex;
+
+    static bool originalOffsetBefore(unsigned int offset, const PositionEntry& entry);
+    static bool modifiedOffsetBefore(unsigned int offset, const PositionEntry& entry);
+
+    const PositionIndex& positionIndex() const;
+
+    bool outputRange(unsigned int from, unsigned int to, QByteArray* buffer, QIODevice* device) const;
+    static bool output(const char* data, unsigned int length, QByteArray* buffer, QIODevice* device);
+
+    QByteArray   m_original;
+    QByteArray   m_added;
+
+    SpanMap      m_spans;
+    InsertionMap m_insertions;
+
+    int          m_totalInsertions;
+    int          m_totalErasures;
+
+    // Rebuilt on the first position query after an edit
+    mutable PositionIndex m_positionIndex;
+    mutable bool          m_positionIndexValid;
+};
+
+inline bool QPieceTable::isModified() const{
+    return m_totalInsertions > 0 || m_totalErasures > 0;
+}
+
+inline int QPieceTable::totalInsertions() const{
+    return m_totalInsertions;
+}
+
+inline int QPieceTable::totalErasures() const{
+    return m_totalErasures;
+}
+
+inline unsigned int QPieceTable::originalSize() const{
+    return static_cast<unsigned int>(m_original.size());
+}
+
+}// namespace
+
+#endif // QPIECETABLE_HPP
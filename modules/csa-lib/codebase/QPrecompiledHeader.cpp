@@ -0,0 +1,216 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#include "QPrecompiledHeader.hpp"
+#include "QCSAConsole.hpp"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QRegExp>
+#include <QHash>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <vector>
+
+namespace csa{
+
+QPrecompiledHeader::QPrecompiledHeader(const QStringList& headers, const QString& searchDir, const QString& cacheDir)
+    : m_cacheDir(cacheDir)
+{
+    if ( m_cacheDir.isEmpty() )
+        m_cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/pch";
+
+    // Headers found on disk are included by their absolute path, the rest are looked up in the include paths
+    for ( QStringList::const_iterator it = headers.begin(); it != headers.end(); ++it ){
+        QFileInfo headerInfo(*it);
+        if ( headerInfo.isRelative() && !searchDir.isEmpty() )
+            headerInfo = QFileInfo(searchDir + "/" + *it);
+
+        m_headers.append(headerInfo.exists() ? QDir::cleanPath(headerInfo.absoluteFilePath()) : *it);
+    }
+}
+
+QPrecompiledHeader::~QPrecompiledHeader(){
+}
+
+bool QPrecompiledHeader::update(CXIndex index, const char* const* translationUnitArgs, int translationUnitNumArgs){
+    if ( m_headers.isEmpty() )
+        return false;
+
+    QString key = cacheKey(translationUnitArgs, translationUnitNumArgs);
+    QString pchPath = m_cacheDir + "/" + key + ".pch";
+
+    if ( m_path == pchPath && isValid() )
+        return true;
+
+    if ( m_path != pchPath && QFileInfo(pchPath).exists() && m_dependencies.read(m_cacheDir + "/" + key + ".json") ){
+        if ( isValid() ){
+            m_path = pchPath;
+            QCSAConsole::log(QCSAConsole::Info2, "Using precompiled header: " + m_path);
+            return true;
+        }
+    }
+
+    m_path.clear();
+    if ( !build(index, translationUnitArgs, translationUnitNumArgs, key) )
+        return false;
+
+    m_path = pchPath;
+    return true;
+}
+
+bool QPrecompiledHeader::isValid() const{
+    return !m_dependencies.hasChanged();
+}
+
+// System headers are only checked when the header is loaded or rebuilt, keeping the check run before each command cheap
+bool QPrecompiledHeader::hasUserHeadersChanged() const{
+    return m_dependencies.hasUserFilesChanged();
+}
+
+QStringList QPrecompiledHeader::detectCommonHeaders(const QStringList& sourceFiles){
+    QRegExp includeExpression("^\\s*#\\s*include\\s*<([^>]+)>");
+
+    // Headers in the order they were first seen, together with the number of sources including them
+    QStringList headers;
+    QHash<QString, int> includeCount;
+
+    for ( QStringList::const_iterator it = sourceFiles.begin(); it != sourceFiles.end(); ++it ){
+        QFile file(*it);
+        if ( !file.open(QIODevice::ReadOnly) )
+            continue;
+
+        QStringList fileHeaders;
+        while ( !file.atEnd() ){
+            QString line = QString::fromUtf8(file.readLine());
+            if ( includeExpression.indexIn(line) != -1 && !fileHeaders.contains(includeExpression.cap(1)) )
+                fileHeaders.append(includeExpression.cap(1));
+        }
+
+        for ( QStringList::const_iterator headerIt = fileHeaders.begin(); headerIt != fileHeaders.end(); ++headerIt ){
+            if ( !includeCount.contains(*headerIt) )
+                headers.append(*headerIt);
+            ++includeCount[*headerIt];
+        }
+    }
+
+    // Only library headers are considered, since project headers are parsed as files of their own. A header is common
+    // if it's included by at least half of the sources.
+    QStringList commonHeaders;
+    if ( sourceFiles.size() < 2 )
+        return commonHeaders;
+
+    for ( QStringList::const_iterator it = headers.begin(); it != headers.end(); ++it ){
+        if ( includeCount[*it] * 2 >= sourceFiles.size() )
+            commonHeaders.append(*it);
+    }
+    return commonHeaders;
+}
+
+QString QPrecompiledHeader::cacheKey(const char* const* translationUnitArgs, int translationUnitNumArgs) const{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    for ( int i = 0; i < translationUnitNumArgs; ++i ){
+        hash.addData(QByteArray(translationUnitArgs[i]));
+        hash.addData("\n", 1);
+    }
+    hash.addData("\n", 1);
+    hash.addData(m_headers.join("\n").toUtf8());
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+bool QPrecompiledHeader::build(
+        CXIndex index,
+        const char* const* translationUnitArgs,
+        int translationUnitNumArgs,
+        const QString& key)
+{
+    m_dependencies.clear();
+
+    if ( !QDir().mkpath(m_cacheDir) ){
+        QCSAConsole::logError("Cannot create precompiled header directory \'" + m_cacheDir + "\'.");
+        return false;
+    }
+
+    QString preludePath  = m_cacheDir + "/" + key + ".hpp";
+    QString pchPath      = m_cacheDir + "/" + key + ".pch";
+    QString manifestPath = m_cacheDir + "/" + key + ".json";
+
+    QFile prelude(preludePath);
+    if ( !prelude.open(QIODevice::WriteOnly) ){
+        QCSAConsole::logError("Cannot open file \'" + preludePath + "\' for writing.");
+        return false;
+    }
+    for ( QStringList::const_iterator it = m_headers.begin(); it != m_headers.end(); ++it ){
+        if ( QFileInfo(*it).isAbsolute() )
+            prelude.write("#include \"" + it->toUtf8() + "\"\n");
+        else
+            prelude.write("#include <" + it->toUtf8() + ">\n");
+    }
+    prelude.close();
+
+    // The prelude is compiled as a header, with the same arguments as the translation units using it
+    std::vector<const char*> args(translationUnitArgs, translationUnitArgs + translationUnitNumArgs);
+    args.push_back("-x");
+    args.push_back("c++-header");
+
+    QByteArray preludePathData = preludePath.toLocal8Bit();
+    QDateTime parseStarted = QDateTime::currentDateTime();
+    CXTranslationUnit transUnit = clang_parseTranslationUnit(
+        index,
+        preludePathData.constData(),
+        &args.front(),
+        static_cast<int>(args.size()),
+        0,
+        0,
+        CXTranslationUnit_Incomplete | CXTranslationUnit_ForSerialization
+    );
+    if ( !transUnit ){
+        QCSAConsole::logError("Failed to parse precompiled header prelude \'" + preludePath + "\'.");
+        return false;
+    }
+
+    // Saved under a temporary name first, since translation units may still be reading the previous header
+    QString temporaryPath = pchPath + ".tmp";
+    int saveResult = clang_saveTranslationUnit(
+        transUnit, temporaryPath.toLocal8Bit().constData(), clang_defaultSaveOptions(transUnit)
+    );
+
+    if ( saveResult == CXSaveError_None )
+        m_dependencies.collect(transUnit, parseStarted);
+    clang_disposeTranslationUnit(transUnit);
+
+    if ( saveResult != CXSaveError_None ){
+        QCSAConsole::logError("Failed to save precompiled header \'" + pchPath + "\'.");
+        QFile::remove(temporaryPath);
+        return false;
+    }
+
+    QFile::remove(pchPath);
+    if ( !QFile::rename(temporaryPath, pchPath) ){
+        QCSAConsole::logError("Failed to replace precompiled header \'" + pchPath + "\'.");
+        return false;
+    }
+
+    if ( !m_dependencies.write(manifestPath) )
+        QCSAConsole::logError("Cannot write precompiled header manifest \'" + manifestPath + "\'.");
+
+    QCSAConsole::log(QCSAConsole::Info1, "Built precompiled header: " + pchPath);
+    return true;
+}
+
+}// namespace
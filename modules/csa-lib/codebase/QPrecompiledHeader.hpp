@@ -0,0 +1,75 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#ifndef QPRECOMPILEDHEADER_HPP
+#define QPRECOMPILEDHEADER_HPP
+
+#include "clang-c/Index.h"
+#include "QCSAGlobal.hpp"
+#include "QDependencyManifest.hpp"
+#include <QStringList>
+
+namespace csa{
+
+// Precompiled header built from a list of headers common to the parsed files. The header is stored in a cache
+// directory under a key computed from the translation unit arguments and the header list, together with a manifest of
+// the files it was built from, so it's rebuilt only when the arguments or any of these files change.
+class Q_CSA_EXPORT QPrecompiledHeader{
+
+public:
+    QPrecompiledHeader(const QStringList& headers, const QString& searchDir = "", const QString& cacheDir = "");
+    ~QPrecompiledHeader();
+
+    const QStringList& headers() const;
+    const QString& cacheDir() const;
+
+    bool update(CXIndex index, const char* const* translationUnitArgs, int translationUnitNumArgs);
+    bool isValid() const;
+    bool hasUserHeadersChanged() const;
+    const QString& path() const;
+
+    static QStringList detectCommonHeaders(const QStringList& sourceFiles);
+
+private:
+    // prevent copy
+    QPrecompiledHeader(const QPrecompiledHeader& other);
+    QPrecompiledHeader& operator=(const QPrecompiledHeader& other);
+
+    QString cacheKey(const char* const* translationUnitArgs, int translationUnitNumArgs) const;
+    bool build(CXIndex index, const char* const* translationUnitArgs, int translationUnitNumArgs, const QString& key);
+
+    QStringList         m_headers;
+    QString             m_cacheDir;
+    QString             m_path;
+    QDependencyManifest m_dependencies;
+};
+
+inline const QStringList& QPrecompiledHeader::headers() const{
+    return m_headers;
+}
+
+inline const QString& QPrecompiledHeader::cacheDir() const{
+    return m_cacheDir;
+}
+
+inline const QString& QPrecompiledHeader::path() const{
+    return m_path;
+}
+
+}// namespace
+
+#endif // QPRECOMPILEDHEADER_HPP
@@ -18,6 +18,7 @@
 #include "QTokenClassifier.hpp"
 #include "QAnnotatedTokenSet.hpp"
 #include <cstdio>
+#include <algorithm>
 
 namespace csa{
 
@@ -27,6 +28,12 @@ QTokenClassifier::QTokenClassifier(const CXTranslationUnit &transUnit, const cha
     initializeTokens(transUnit, getFileRange(transUnit, fileName));
 }
 
+QTokenClassifier::QTokenClassifier(const CXTranslationUnit &transUnit, const char *fileName, unsigned int fileSize)
+    : m_file(fileName){
+
+    initializeTokens(transUnit, getFileRange(transUnit, fileName, fileSize));
+}
+
 QTokenClassifier::~QTokenClassifier(){
     disposeTokenSets();
 }
@@ -54,30 +61,29 @@ void QTokenClassifier::initializeTokens(const CXTranslationUnit &transUnit, cons
     QAnnotatedTokenSet* lastAddedToken = 0;
     for( unsigned int i = 0; i < m_tokensCount; ++i ){
 
-        bool found = false;
+        QAnnotatedTokenSet* owner = 0;
         if ( lastAddedToken ){
-            if ( clang_equalCursors(lastAddedToken->cursor(), cursors[i]) ){
-                lastAddedToken->append(m_tokens[i]);
-                found = true;
-            }
+            if ( clang_equalCursors(lastAddedToken->cursor(), cursors[i]) )
+                owner = lastAddedToken;
         }
 
-        if ( !found ){
+        if ( !owner ){
             for ( QTokenClassifier::Iterator it = tokenSetBegin(); it != tokenSetEnd(); ++it ){
                 if ( clang_equalCursors( (*it)->cursor(), cursors[i] ) ){
-                    (*it)->append(m_tokens[i]);
-                    found = true;
+                    owner = *it;
                     break;
                 }
             }
         }
 
-        if ( !found ){
-            QAnnotatedTokenSet* tokenSet = new QAnnotatedTokenSet(cursors[i], transUnit);
-            tokenSet->append(m_tokens[i]);
-            m_tokenSets.push_back(tokenSet);
-            lastAddedToken = tokenSet;
+        if ( !owner ){
+            owner = new QAnnotatedTokenSet(cursors[i], transUnit);
+            m_tokenSets.push_back(owner);
+            lastAddedToken = owner;
         }
+
+        owner->append(m_tokens[i]);
+        indexToken(m_tokens[i], owner->tokenList().last());
     }
 
     delete[] cursors;
@@ -89,11 +95,49 @@ void QTokenClassifier::disposeTokenSets(){
     clang_disposeTokens(m_translationUnit, m_tokens, m_tokensCount);
     m_tokensCount = 0;
     m_tokenSets.clear();
+    m_tokenStartOffsets.clear();
+    m_tokenEndOffsets.clear();
+    m_tokenIndex.clear();
+}
+
+void QTokenClassifier::indexToken(const CXToken& token, QAnnotatedToken* annotatedToken){
+    CXSourceRange extent = clang_getTokenExtent(m_translationUnit, token);
+
+    unsigned int startOffset, endOffset;
+    clang_getSpellingLocation(clang_getRangeStart(extent), 0, 0, 0, &startOffset);
+    clang_getSpellingLocation(clang_getRangeEnd(extent), 0, 0, 0, &endOffset);
+
+    m_tokenStartOffsets.push_back(startOffset);
+    m_tokenEndOffsets.push_back(endOffset);
+    m_tokenIndex.push_back(annotatedToken);
 }
 
-void QTokenClassifier::reparse(){
+size_t QTokenClassifier::firstTokenEndingAfter(unsigned int offset) const{
+    return std::upper_bound(m_tokenEndOffsets.begin(), m_tokenEndOffsets.end(), offset) - m_tokenEndOffsets.begin();
+}
+
+QAnnotatedToken* QTokenClassifier::tokenAt(unsigned int offset) const{
+    size_t index = firstTokenEndingAfter(offset);
+    if ( index < m_tokenIndex.size() && m_tokenStartOffsets[index] <= offset )
+        return m_tokenIndex[index];
+    return 0;
+}
+
+QTokenClassifier::TokenVector QTokenClassifier::tokensInRange(unsigned int from, unsigned int to) const{
+    TokenVector tokens;
+    for ( size_t index = firstTokenEndingAfter(from);
+          index < m_tokenIndex.size() && m_tokenStartOffsets[index] <= to;
+          ++index )
+    {
+        tokens.push_back(m_tokenIndex[index]);
+    }
+    return tokens;
+}
+
+void QTokenClassifier::reparse(const CXTranslationUnit& transUnit, unsigned int fileSize){
+    // Tokens are disposed with the unit they were created from
     disposeTokenSets();
-    initializeTokens(m_translationUnit, getFileRange(m_translationUnit, m_file.c_str()));
+    initializeTokens(transUnit, getFileRange(transUnit, m_file.c_str(), fileSize));
 }
 
 void QTokenClassifier::dump(std::string &str){
@@ -115,9 +159,13 @@ unsigned int QTokenClassifier::getFileSize(const char* file){
 }
 
 CXSourceRange QTokenClassifier::getFileRange(const CXTranslationUnit& tu, const char* file){
+    return getFileRange(tu, file, getFileSize(file));
+}
+
+CXSourceRange QTokenClassifier::getFileRange(const CXTranslationUnit& tu, const char* file, unsigned int fileSize){
     CXFile clangFile = clang_getFile(tu, file);
     CXSourceLocation fStart = clang_getLocationForOffset(tu, clangFile, 0);
-    CXSourceLocation fEnd   = clang_getLocationForOffset(tu, clangFile, getFileSize(file));
+    CXSourceLocation fEnd   = clang_getLocationForOffset(tu, clangFile, fileSize);
     return clang_getRange(fStart, fEnd);
 }
 
@@ -25,6 +25,7 @@
 
 namespace csa{
 
+class QAnnotatedToken;
 class QAnnotatedTokenSet;
 class Q_CSA_EXPORT QTokenClassifier{
 
@@ -32,9 +33,11 @@ public:
     typedef std::vector<QAnnotatedTokenSet*> TokenSetVector;
     typedef std::vector<QAnnotatedTokenSet*>::iterator Iterator;
     typedef std::vector<QAnnotatedTokenSet*>::const_iterator ConstIterator;
+    typedef std::vector<QAnnotatedToken*> TokenVector;
 
 public:
     QTokenClassifier(const CXTranslationUnit& transUnit, const char* fileName );
+    QTokenClassifier(const CXTranslationUnit& transUnit, const char* fileName, unsigned int fileSize);
     ~QTokenClassifier();
 
     QAnnotatedTokenSet* findTokenSet(const CXCursor& cursor);
@@ -45,7 +48,10 @@ public:
     ConstIterator tokenSetEnd() const;
 
     void appendTokenSet(QAnnotatedTokenSet* tokenSet);
-    void reparse();
+    void reparse(const CXTranslationUnit& transUnit, unsigned int fileSize);
+
+    QAnnotatedToken* tokenAt(unsigned int offset) const;
+    TokenVector tokensInRange(unsigned int from, unsigned int to) const;
 
     const CXTranslationUnit& translationUnit() const;
     const std::string& file() const;
@@ -54,16 +60,25 @@ public:
 
     static unsigned int  getFileSize(const char* file);
     static CXSourceRange getFileRange(const CXTranslationUnit& tu, const char* file);
+    static CXSourceRange getFileRange(const CXTranslationUnit& tu, const char* file, unsigned int fileSize);
 
 private:
     void initializeTokens(const CXTranslationUnit& transUnit, const CXSourceRange& range);
     void disposeTokenSets();
 
+    void indexToken(const CXToken& token, QAnnotatedToken* annotatedToken);
+    size_t firstTokenEndingAfter(unsigned int offset) const;
+
     TokenSetVector    m_tokenSets;
     CXTranslationUnit m_translationUnit;
     CXToken*          m_tokens;
     unsigned int      m_tokensCount;
 
+    // Tokens in file order, indexed by their start and end offsets
+    std::vector<unsigned int> m_tokenStartOffsets;
+    std::vector<unsigned int> m_tokenEndOffsets;
+    TokenVector               m_tokenIndex;
+
     std::string       m_file;
 
 };
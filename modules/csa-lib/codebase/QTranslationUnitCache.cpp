@@ -0,0 +1,115 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#include "QTranslationUnitCache.hpp"
+#include "QDependencyManifest.hpp"
+#include "QCSAConsole.hpp"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+
+namespace csa{
+
+QTranslationUnitCache::QTranslationUnitCache(const QString& cacheDir)
+    : m_cacheDir(cacheDir)
+{
+    if ( m_cacheDir.isEmpty() )
+        m_cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/ast";
+}
+
+QTranslationUnitCache::~QTranslationUnitCache(){
+}
+
+CXTranslationUnit QTranslationUnitCache::load(
+        CXIndex index,
+        const QString& file,
+        const char* const* translationUnitArgs,
+        int translationUnitNumArgs) const
+{
+    QString key = cacheKey(file, translationUnitArgs, translationUnitNumArgs);
+    QString astPath = m_cacheDir + "/" + key + ".ast";
+    if ( !QFileInfo(astPath).exists() )
+        return 0;
+
+    QDependencyManifest dependencies;
+    if ( !dependencies.read(m_cacheDir + "/" + key + ".json") || dependencies.hasChanged() ){
+        QCSAConsole::log(QCSAConsole::Info2, "Cached translation unit is out of date: " + file);
+        return 0;
+    }
+
+    CXTranslationUnit transUnit = clang_createTranslationUnit(index, astPath.toLocal8Bit().constData());
+    if ( !transUnit ){
+        QCSAConsole::log(QCSAConsole::Info2, "Failed to load cached translation unit: " + file);
+        return 0;
+    }
+
+    QCSAConsole::log(QCSAConsole::Info2, "Loaded cached translation unit: " + file);
+    return transUnit;
+}
+
+bool QTranslationUnitCache::save(
+        CXTranslationUnit transUnit,
+        const QString& file,
+        const char* const* translationUnitArgs,
+        int translationUnitNumArgs,
+        const QDateTime& parseStarted) const
+{
+    if ( !QDir().mkpath(m_cacheDir) ){
+        QCSAConsole::logError("Cannot create translation unit cache directory \'" + m_cacheDir + "\'.");
+        return false;
+    }
+
+    QString key = cacheKey(file, translationUnitArgs, translationUnitNumArgs);
+    QString astPath = m_cacheDir + "/" + key + ".ast";
+
+    // The manifest is removed first, so an interrupted save never leaves a unit that looks valid
+    QString manifestPath = m_cacheDir + "/" + key + ".json";
+    QFile::remove(manifestPath);
+
+    if ( clang_saveTranslationUnit(
+             transUnit, astPath.toLocal8Bit().constData(), clang_defaultSaveOptions(transUnit)) != CXSaveError_None )
+    {
+        QCSAConsole::log(QCSAConsole::Info2, "Failed to cache translation unit: " + file);
+        return false;
+    }
+
+    QDependencyManifest dependencies;
+    dependencies.collect(transUnit, parseStarted);
+    if ( !dependencies.write(manifestPath) ){
+        QCSAConsole::logError("Cannot write translation unit manifest \'" + manifestPath + "\'.");
+        return false;
+    }
+    return true;
+}
+
+QString QTranslationUnitCache::cacheKey(
+        const QString& file,
+        const char* const* translationUnitArgs,
+        int translationUnitNumArgs) const
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(QDir::cleanPath(QFileInfo(file).absoluteFilePath()).toUtf8());
+    for ( int i = 0; i < translationUnitNumArgs; ++i ){
+        hash.addData("\n", 1);
+        hash.addData(QByteArray(translationUnitArgs[i]));
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+}// namespace
@@ -0,0 +1,68 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#ifndef QTRANSLATIONUNITCACHE_HPP
+#define QTRANSLATIONUNITCACHE_HPP
+
+#include "clang-c/Index.h"
+#include "QCSAGlobal.hpp"
+#include <QString>
+#include <QDateTime>
+
+namespace csa{
+
+// Parsed translation units saved to a cache directory, keyed by the main file and the translation unit arguments.
+// Each unit is stored with a manifest of the files it was parsed from, and is only loaded back while none of them
+// changed. Units loaded from the cache cannot be reparsed by libclang, so they need to be parsed again instead.
+class Q_CSA_EXPORT QTranslationUnitCache{
+
+public:
+    explicit QTranslationUnitCache(const QString& cacheDir = "");
+    ~QTranslationUnitCache();
+
+    const QString& cacheDir() const;
+
+    CXTranslationUnit load(
+        CXIndex index,
+        const QString& file,
+        const char* const* translationUnitArgs,
+        int translationUnitNumArgs) const;
+
+    bool save(
+        CXTranslationUnit transUnit,
+        const QString& file,
+        const char* const* translationUnitArgs,
+        int translationUnitNumArgs,
+        const QDateTime& parseStarted) const;
+
+private:
+    // prevent copy
+    QTranslationUnitCache(const QTranslationUnitCache& other);
+    QTranslationUnitCache& operator=(const QTranslationUnitCache& other);
+
+    QString cacheKey(const QString& file, const char* const* translationUnitArgs, int translationUnitNumArgs) const;
+
+    QString m_cacheDir;
+};
+
+inline const QString& QTranslationUnitCache::cacheDir() const{
+    return m_cacheDir;
+}
+
+}// namespace
+
+#endif // QTRANSLATIONUNITCACHE_HPP
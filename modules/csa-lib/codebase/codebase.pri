@@ -11,7 +11,12 @@ HEADERS += \
     $$PWD/QASTSearch.hpp \
     $$PWD/QSourceLocation_p.hpp \
     $$PWD/QAnnotatedToken_p.hpp \
-    $$PWD/QCSAConsole.hpp
+    $$PWD/QCSAConsole.hpp \
+    $$PWD/QPieceTable.hpp \
+    $$PWD/QPrecompiledHeader.hpp \
+    $$PWD/QDependencyManifest.hpp \
+    $$PWD/QTranslationUnitCache.hpp \
+    $$PWD/QCSAProfiler.hpp
 
 SOURCES += \
     $$PWD/QCodeBase.cpp \
@@ -21,4 +26,9 @@ SOURCES += \
     $$PWD/QTokenClassifier.cpp \
     $$PWD/QAnnotatedToken.cpp \
     $$PWD/QASTSearch.cpp \
-    $$PWD/QCSAConsole.cpp
+    $$PWD/QCSAConsole.cpp \
+    $$PWD/QPieceTable.cpp \
+    $$PWD/QPrecompiledHeader.cpp \
+    $$PWD/QDependencyManifest.cpp \
+    $$PWD/QTranslationUnitCache.cpp \
+    $$PWD/QCSAProfiler.cpp
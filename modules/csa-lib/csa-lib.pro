@@ -1,6 +1,6 @@
 TEMPLATE = lib
 TARGET   = csa
-QT      += qml quick script
+QT      += qml quick script concurrent
 CONFIG  += qt
 
 DEFINES += Q_CSA
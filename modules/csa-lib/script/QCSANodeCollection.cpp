@@ -0,0 +1,304 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#include "QCSAPluginLoader.hpp"
+#include "QCSANodeCollection.hpp"
+#include "QCodeBase.hpp"
+#include "QASTNode.hpp"
+#include "QSourceLocation.hpp"
+#include "QCSAConsole.hpp"
+#include "QCSAProfiler.hpp"
+#include <QJSEngine>
+
+namespace csa{
+
+using namespace ast;
+
+QCSANodeCollection::QCSANodeCollection(QJSEngine* engine, QCodeBase* codeBase, QObject* parent)
+    : QObject(parent)
+    , m_engine(engine)
+    , m_codeBase(codeBase)
+{
+}
+
+QCSANodeCollection::~QCSANodeCollection(){
+}
+
+void QCSANodeCollection::append(QASTNode* node){
+    if ( node )
+        m_nodes.append(node);
+}
+
+int QCSANodeCollection::size() const{
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    return m_nodes.size();
+}
+
+QList<QObject*> QCSANodeCollection::nodes() const{
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QList<QObject*> result;
+    for ( NodeList::const_iterator it = m_nodes.begin(); it != m_nodes.end(); ++it ){
+        if ( !it->isNull() ){
+            // Nodes keep their wrapper, so the array holds the same objects on every access
+            (*it)->scriptValue(m_engine);
+            result.append(it->data());
+        }
+    }
+    return result;
+}
+
+void QCSANodeCollection::setNodes(const QJSValue& nodes){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    m_nodes.clear();
+
+    if ( nodes.isArray() ){
+        int length = nodes.property("length").toInt();
+        for ( int i = 0; i < length; ++i )
+            append(qobject_cast<QASTNode*>(nodes.property(static_cast<quint32>(i)).toQObject()));
+    } else if ( nodes.isQObject() ){
+        QCSANodeCollection* collection = qobject_cast<QCSANodeCollection*>(nodes.toQObject());
+        if ( collection )
+            m_nodes = collection->nodeList();
+        else
+            append(qobject_cast<QASTNode*>(nodes.toQObject()));
+    }
+}
+
+QCSANodeCollection* QCSANodeCollection::create(const QJSValue& nodes){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QCSANodeCollection* collection = createEmpty();
+    collection->setNodes(nodes);
+    return collection;
+}
+
+QCSANodeCollection* QCSANodeCollection::select(const QString& selector, const QString& type){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QCSANodeCollection* collection = createEmpty();
+    if ( !m_codeBase )
+        return collection;
+
+    QList<QObject*> foundNodes = m_codeBase->find(normalizedSelector(selector), type);
+    for ( QList<QObject*>::iterator it = foundNodes.begin(); it != foundNodes.end(); ++it )
+        collection->append(qobject_cast<QASTNode*>(*it));
+    return collection;
+}
+
+QCSANodeCollection* QCSANodeCollection::children(const QString& type){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QCSANodeCollection* collection = createEmpty();
+    for ( NodeList::const_iterator it = m_nodes.begin(); it != m_nodes.end(); ++it ){
+        if ( it->isNull() )
+            continue;
+
+        const QList<QASTNode*>& nodeChildren = (*it)->astChildren();
+        for ( QList<QASTNode*>::const_iterator childIt = nodeChildren.begin(); childIt != nodeChildren.end(); ++childIt ){
+            if ( type == "" || (*childIt)->typeName() == type )
+                collection->append(*childIt);
+        }
+    }
+    return collection;
+}
+
+QCSANodeCollection* QCSANodeCollection::find(const QString& selector, const QString& type){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QString searchData = normalizedSelector(selector);
+
+    QCSANodeCollection* collection = createEmpty();
+    for ( NodeList::const_iterator it = m_nodes.begin(); it != m_nodes.end(); ++it ){
+        if ( it->isNull() )
+            continue;
+
+        QList<QObject*> foundNodes = (*it)->find(searchData, type);
+        for ( QList<QObject*>::iterator foundIt = foundNodes.begin(); foundIt != foundNodes.end(); ++foundIt )
+            collection->append(qobject_cast<QASTNode*>(*foundIt));
+    }
+    return collection;
+}
+
+QCSANodeCollection* QCSANodeCollection::filter(const QJSValue& predicate){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QCSANodeCollection* collection = createEmpty();
+
+    // A string filters by type without calling back into javascript
+    if ( predicate.isString() ){
+        QString type = predicate.toString();
+        for ( NodeList::const_iterator it = m_nodes.begin(); it != m_nodes.end(); ++it ){
+            if ( !it->isNull() && (*it)->typeName() == type )
+                collection->append(*it);
+        }
+        return collection;
+    }
+
+    if ( !predicate.isCallable() )
+        return collection;
+
+    QJSValue callback(predicate);
+    for ( int i = 0; i < m_nodes.size(); ++i ){
+        if ( m_nodes[i].isNull() )
+            continue;
+
+        QJSValue result;
+        {
+            QCSAProfiler::ScriptScope profilerScript;
+            result = callback.call(QJSValueList() << m_nodes[i]->scriptValue(m_engine) << i);
+        }
+        if ( result.isError() ){
+            QCSAConsole::logError("Uncaught javascript exception in filter: " + result.toString());
+            break;
+        }
+        if ( result.toBool() )
+            collection->append(m_nodes[i]);
+    }
+    return collection;
+}
+
+QJSValue QCSANodeCollection::map(const QJSValue& callback){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QJSValue result = m_engine->newArray(static_cast<uint>(m_nodes.size()));
+    if ( !callback.isCallable() )
+        return result;
+
+    QJSValue mapCallback(callback);
+    quint32 resultIndex = 0;
+    for ( int i = 0; i < m_nodes.size(); ++i ){
+        if ( m_nodes[i].isNull() )
+            continue;
+
+        QJSValue value;
+        {
+            QCSAProfiler::ScriptScope profilerScript;
+            value = mapCallback.call(QJSValueList() << m_nodes[i]->scriptValue(m_engine) << i);
+        }
+        if ( value.isError() ){
+            QCSAConsole::logError("Uncaught javascript exception in map: " + value.toString());
+            break;
+        }
+        result.setProperty(resultIndex++, value);
+    }
+
+    // Guarded nodes that were deleted are skipped
+    result.setProperty("length", resultIndex);
+    return result;
+}
+
+void QCSANodeCollection::remove(){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    for ( NodeList::iterator it = m_nodes.begin(); it != m_nodes.end(); ++it ){
+        if ( !it->isNull() )
+            (*it)->remove();
+    }
+    if ( m_codeBase )
+        m_codeBase->save();
+}
+
+QJSValue QCSANodeCollection::pluck(const QStringList& fields){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QJSValue result = m_engine->newArray(static_cast<uint>(m_nodes.size()));
+
+    quint32 resultIndex = 0;
+    for ( NodeList::const_iterator it = m_nodes.begin(); it != m_nodes.end(); ++it ){
+        if ( it->isNull() )
+            continue;
+
+        QJSValue row = m_engine->newObject();
+        for ( QStringList::const_iterator fieldIt = fields.begin(); fieldIt != fields.end(); ++fieldIt )
+            row.setProperty(*fieldIt, fieldValue(*it, *fieldIt));
+        result.setProperty(resultIndex++, row);
+    }
+
+    result.setProperty("length", resultIndex);
+    return result;
+}
+
+QJSValue QCSANodeCollection::columns(const QStringList& fields){
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QList<QASTNode*> nodes;
+    for ( NodeList::const_iterator it = m_nodes.begin(); it != m_nodes.end(); ++it ){
+        if ( !it->isNull() )
+            nodes.append(*it);
+    }
+
+    QJSValue result = m_engine->newObject();
+    for ( QStringList::const_iterator fieldIt = fields.begin(); fieldIt != fields.end(); ++fieldIt ){
+        QJSValue column = m_engine->newArray(static_cast<uint>(nodes.size()));
+        for ( int i = 0; i < nodes.size(); ++i )
+            column.setProperty(static_cast<quint32>(i), fieldValue(nodes[i], *fieldIt));
+        result.setProperty(*fieldIt, column);
+    }
+    return result;
+}
+
+QString QCSANodeCollection::toString() const{
+    QCSAProfiler::CallScope profilerScope(Q_FUNC_INFO);
+    QString result = "NodeCollection[";
+    bool first = true;
+    for ( NodeList::const_iterator it = m_nodes.begin(); it != m_nodes.end(); ++it ){
+        if ( it->isNull() )
+            continue;
+        if ( !first )
+            result += ", ";
+        result += "\'" + (*it)->description() + "\'";
+        first = false;
+    }
+    return result + "]";
+}
+
+QCSANodeCollection* QCSANodeCollection::createEmpty() const{
+    // Collections returned to javascript have no parent, so they are owned by the engine
+    return new QCSANodeCollection(m_engine, m_codeBase);
+}
+
+QJSValue QCSANodeCollection::fieldValue(QASTNode* node, const QString& field){
+    if ( field == "identifier" )
+        return QJSValue(node->identifier());
+    if ( field == "typeName" )
+        return QJSValue(node->typeName());
+    if ( field == "description" )
+        return QJSValue(node->description());
+    if ( field == "breadcrumbs" )
+        return QJSValue(node->breadcrumbs());
+    if ( field == "text" )
+        return QJSValue(node->text());
+
+    // Position fields of nodes without a range are left undefined
+    QSourceLocation* rangeStart = node->rangeStartLocation();
+    QSourceLocation* rangeEnd   = node->rangeEndLocation();
+    if ( field == "file" )
+        return rangeStart ? QJSValue(rangeStart->filePath()) : QJSValue();
+    if ( field == "line" )
+        return rangeStart ? QJSValue(rangeStart->line()) : QJSValue();
+    if ( field == "column" )
+        return rangeStart ? QJSValue(rangeStart->column()) : QJSValue();
+    if ( field == "offset" )
+        return rangeStart ? QJSValue(rangeStart->offset()) : QJSValue();
+    if ( field == "endLine" )
+        return rangeEnd ? QJSValue(rangeEnd->line()) : QJSValue();
+    if ( field == "endColumn" )
+        return rangeEnd ? QJSValue(rangeEnd->column()) : QJSValue();
+    if ( field == "endOffset" )
+        return rangeEnd ? QJSValue(rangeEnd->offset()) : QJSValue();
+
+    // Any other field is a node property, such as the 'type' of a field or the 'returnType' of a method
+    return QJSValue(node->prop(field));
+}
+
+QString QCSANodeCollection::normalizedSelector(const QString& selector){
+    if ( selector.endsWith('/') )
+        return selector;
+    return selector + "/";
+}
+
+}// namespace
@@ -0,0 +1,89 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#ifndef QCSANODECOLLECTION_HPP
+#define QCSANODECOLLECTION_HPP
+
+#include "QCSAGlobal.hpp"
+#include <QObject>
+#include <QList>
+#include <QStringList>
+#include <QPointer>
+#include <QJSValue>
+
+class QJSEngine;
+
+namespace csa{
+
+class QCodeBase;
+
+namespace ast{
+class QASTNode;
+}
+
+// Native backend of the script NodeCollection. Nodes are kept on this side, so chained selections only cross into
+// javascript once, for the final result. Nodes are guarded, since reparsing a file deletes them.
+class Q_CSA_EXPORT QCSANodeCollection : public QObject{
+
+    Q_OBJECT
+
+public:
+    typedef QList<QPointer<ast::QASTNode> > NodeList;
+
+public:
+    QCSANodeCollection(QJSEngine* engine, QCodeBase* codeBase, QObject* parent = 0);
+    ~QCSANodeCollection();
+
+    const NodeList& nodeList() const;
+    void append(ast::QASTNode* node);
+
+public slots:
+    int size() const;
+    QList<QObject*> nodes() const;
+    void setNodes(const QJSValue& nodes);
+
+    csa::QCSANodeCollection* create(const QJSValue& nodes);
+    csa::QCSANodeCollection* select(const QString& selector, const QString& type = "");
+
+    csa::QCSANodeCollection* children(const QString& type = "");
+    csa::QCSANodeCollection* find(const QString& selector, const QString& type = "");
+    csa::QCSANodeCollection* filter(const QJSValue& predicate);
+    QJSValue map(const QJSValue& callback);
+    void remove();
+
+    QJSValue pluck(const QStringList& fields);
+    QJSValue columns(const QStringList& fields);
+
+    QString toString() const;
+
+private:
+    csa::QCSANodeCollection* createEmpty() const;
+    static QJSValue fieldValue(ast::QASTNode* node, const QString& field);
+    static QString normalizedSelector(const QString& selector);
+
+    QJSEngine* m_engine;
+    QCodeBase* m_codeBase;
+    NodeList   m_nodes;
+};
+
+inline const QCSANodeCollection::NodeList& QCSANodeCollection::nodeList() const{
+    return m_nodes;
+}
+
+}// namespace
+
+#endif // QCSANODECOLLECTION_HPP
@@ -21,6 +21,11 @@
 #include "QSourceLocationConvert.hpp"
 #include "QAnnotatedTokenConvert.hpp"
 #include "QCodeBase.hpp"
+#include "QASTFile.hpp"
+#include "QCSANodeCollection.hpp"
+#include "QCSAWorkerPool.hpp"
+#include "QCSAScriptWatchdog.hpp"
+#include "QCSAProfiler.hpp"
 
 #include <QList>
 #include <QFileInfo>
@@ -28,12 +33,48 @@
 #include <QQmlEngine>
 #include <QJSValue>
 #include <QJSValueIterator>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QThread>
 
 namespace csa{
 
+namespace{
+
+// Matches commands that only call a global function with json arguments, e.g. 'addGetter("ic")'
+bool parseInvocation(const QString& jsCode, QString* functionName, QJsonArray* arguments){
+    static QRegularExpression invocationExpression(
+        "^\\s*([A-Za-z_$][\\w$]*)\\s*\\((.*)\\)\\s*;?\\s*$", QRegularExpression::DotMatchesEverythingOption
+    );
+
+    QRegularExpressionMatch match = invocationExpression.match(jsCode);
+    if ( !match.hasMatch() )
+        return false;
+
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(("[" + match.captured(2) + "]").toUtf8(), &error);
+    if ( error.error != QJsonParseError::NoError || !document.isArray() )
+        return false;
+
+    *functionName = match.captured(1);
+    *arguments    = document.array();
+    return true;
+}
+
+QString invocationText(const QString& functionName, const QJsonArray& arguments){
+    QString argumentList = QString::fromUtf8(QJsonDocument(arguments).toJson(QJsonDocument::Compact));
+    return functionName + "(" + argumentList.mid(1, argumentList.size() - 2) + ")";
+}
+
+}// namespace
+
 QCSAPluginLoader::QCSAPluginLoader(QJSEngine* engine, QObject* parent)
     : QObject(parent)
     , m_engine(engine)
+    , m_codeBase(0)
+    , m_timeBudget(0)
+    , m_watchdog(0)
+    , m_workerPool(0)
 {
     if ( !m_engine->globalObject().hasProperty("console") )
         setContextObject("console", &QCSAConsole::instance());
@@ -44,46 +85,74 @@ QCSAPluginLoader::~QCSAPluginLoader(){
 
 bool QCSAPluginLoader::loadNodeCollection(){
 
+    // Collections keep their nodes in a native QCSANodeCollection. The nodes array is only created when a script
+    // accesses it, after which it's the one passed back to the native side.
+    setContextObject("__nodeCollection", new QCSANodeCollection(m_engine, m_codeBase, this));
+
     QJSValue evaluateResult = m_engine->evaluate(
-        "function NodeCollection(nodes){this.nodes = nodes ? nodes : [];} \n"
-
-        "NodeCollection.prototype.children = function(){ \n"
-        "    var newCollection = new NodeCollection(); \n"
-        "    for ( var i = 0; i < this.nodes.length; ++i ){ \n"
-        "        var nodeChildren = this.nodes[i].children(); \n"
-        "        for ( var j = 0; j < nodeChildren.length; ++j ) \n"
-        "            newCollection.nodes.push(nodeChildren[j]); \n"
+        "function NodeCollection(nodes){ \n"
+        "    this._collection = __nodeCollection.create(typeof nodes === 'undefined' ? [] : nodes); \n"
+        "    this._nodes = null; \n"
+        "} \n"
+
+        "NodeCollection.wrap = function(collection){ \n"
+        "    var wrapped = Object.create(NodeCollection.prototype); \n"
+        "    wrapped._collection = collection; \n"
+        "    wrapped._nodes = null; \n"
+        "    return wrapped; \n"
+        "} \n"
+
+        "Object.defineProperty(NodeCollection.prototype, 'nodes', { \n"
+        "    get : function(){ \n"
+        "        if ( this._nodes === null ) \n"
+        "            this._nodes = this._collection.nodes(); \n"
+        "        return this._nodes; \n"
+        "    }, \n"
+        "    set : function(nodes){ \n"
+        "        this._nodes = nodes; \n"
         "    } \n"
-        "    return newCollection; \n"
+        "}); \n"
+
+        "NodeCollection.prototype.native = function(){ \n"
+        "    if ( this._nodes !== null ) \n"
+        "        this._collection.setNodes(this._nodes); \n"
+        "    return this._collection; \n"
+        "} \n"
+
+        "NodeCollection.prototype.size = function(){ \n"
+        "    return this.native().size(); \n"
+        "} \n"
+
+        "NodeCollection.prototype.children = function(type){ \n"
+        "    return NodeCollection.wrap(this.native().children(typeof type === 'undefined' ? '' : type)); \n"
         "} \n"
 
         "NodeCollection.prototype.find = function(selector, typeName){ \n"
-        "    if ( selector.indexOf('/', selector.length - 1) === -1 )\n"
-        "       selector += '/';\n"
-        "    var newCollection = new NodeCollection(); \n"
-        "    for ( var i = 0; i < this.nodes.length; ++i ){ \n"
-        "        var foundChildren = this.nodes[i].find(selector,(typeof typeName === 'undefined' ? '' : typeName)); \n"
-        "        for ( var j = 0; j < foundChildren.length; ++j ) \n"
-        "            newCollection.nodes.push(foundChildren[j]); \n"
-        "    } \n"
-        "    return newCollection; \n"
+        "    return NodeCollection.wrap(this.native().find(selector, typeof typeName === 'undefined' ? '' : typeName)); \n"
+        "} \n"
+
+        "NodeCollection.prototype.filter = function(predicate){ \n"
+        "    return NodeCollection.wrap(this.native().filter(predicate)); \n"
+        "} \n"
+
+        "NodeCollection.prototype.map = function(callback){ \n"
+        "    return this.native().map(callback); \n"
+        "} \n"
+
+        "NodeCollection.prototype.pluck = function(fields){ \n"
+        "    return this.native().pluck(fields); \n"
+        "} \n"
+
+        "NodeCollection.prototype.columns = function(fields){ \n"
+        "    return this.native().columns(fields); \n"
         "} \n"
 
         "NodeCollection.prototype.remove = function(){ \n"
-        "    for ( var i = 0; i < this.nodes.length; ++i ){\n"
-        "        this.nodes[i].remove();\n"
-        "    }\n"
-        "    codeBase.save()\n"
+        "    this.native().remove(); \n"
         "} \n"
 
         "NodeCollection.prototype.toString = function(){ \n"
-        "    var ret = 'NodeCollection['; \n"
-        "    for ( var i = 0; i < this.nodes.length; ++i ){ \n"
-        "        if ( i !== 0 ) \n"
-        "            ret += ', '; \n"
-        "        ret += '\\'' + this.nodes[i].description() + '\\''; \n"
-        "    } \n"
-        "    return ret + ']'; \n"
+        "    return this.native().toString(); \n"
         "} \n"
 
         "NodeCollection.registerPlugin = function(properties){ \n"
@@ -104,9 +173,11 @@ bool QCSAPluginLoader::loadNodesFunction(){
 
     QJSValue evaluateResult = m_engine->evaluate(
         "function nodes(selector, type){ \n"
-        "    if ( selector.indexOf('/', selector.length - 1) === -1 )\n"
-        "       selector += '/';\n"
-        "    return new NodeCollection(codeBase.find(selector, type ? type : '')); \n"
+        "    return NodeCollection.wrap(__nodeCollection.select(selector, type ? type : '')); \n"
+        "} \n"
+
+        "function table(selector, fields, type){ \n"
+        "    return __nodeCollection.select(selector, type ? type : '').pluck(fields); \n"
         "} \n"
     );
 
@@ -154,9 +225,28 @@ bool QCSAPluginLoader::loadFileFunctions(){
 
 }
 
-int QCSAPluginLoader::loadPlugins(const QString& path){
-    QJSEngine* engine = m_engine;
+bool QCSAPluginLoader::loadWorkerPool(const QString& pluginPath, int maxWorkers){
 
+    // Mapped functions are passed to the workers as source, so they cannot use variables from enclosing scopes
+    m_workerPool = new QCSAWorkerPool(m_engine, m_codeBase, pluginPath, maxWorkers, this);
+    setContextObject("__workerPool", m_workerPool);
+
+    QJSValue evaluateResult = m_engine->evaluate(
+        "function parallelMap(files, fn){ \n"
+        "    if ( typeof fn !== 'function' ) \n"
+        "        throw new Error('parallelMap: The second argument must be a function.'); \n"
+        "    return __workerPool.map(files, fn.toString()); \n"
+        "}\n"
+    );
+
+    if ( evaluateResult.isError() ){
+        QCSAConsole::logError("Error loading worker pool: " + evaluateResult.toString());
+        return false;
+    }
+    return true;
+}
+
+int QCSAPluginLoader::loadPlugins(const QString& path){
     QFileInfo fInfo(path);
     if ( !fInfo.exists() ){
         QCSAConsole::logError("Path does not exist: " + path + ".");
@@ -174,22 +264,61 @@ int QCSAPluginLoader::loadPlugins(const QString& path){
             }
         }
     } else {
-        QFile configScript(path);
-        if ( !configScript.open(QIODevice::ReadOnly) ){
-            QCSAConsole::logError(
-                "Error opening js configuration file. Make sure the file is present in " + path + ".");
-            return 2;
-        }
+        return evaluatePlugin(path);
+    }
 
-        QTextStream configStream(&configScript);
-        QJSValue evaluateResult = engine->evaluate(configStream.readAll(), configScript.fileName());
+    return 0;
+}
 
-        if ( evaluateResult.isError() ){
-            QCSAConsole::logError("Uncaught javascript exception: " + evaluateResult.toString());
-            return 3;
-        }
+int QCSAPluginLoader::registerPlugins(const QString& path){
+    if ( !m_pluginManifest.scan(path) )
+        return -1;
+    return 0;
+}
+
+bool QCSAPluginLoader::loadRequiredPlugins(const QString& jsCode){
+    QStringList pluginFiles = m_pluginManifest.requiredPluginFiles(jsCode);
+    for ( QStringList::const_iterator it = pluginFiles.begin(); it != pluginFiles.end(); ++it ){
+        if ( m_loadedPlugins.contains(*it) )
+            continue;
+
+        // Plugins can call functions exported by other plugins, which are loaded before this one returns
+        QString source;
+        if ( evaluatePlugin(*it, &source) != 0 )
+            return false;
+        if ( !loadRequiredPlugins(source) )
+            return false;
+    }
+    return true;
+}
+
+int QCSAPluginLoader::evaluatePlugin(const QString& path, QString* source){
+    if ( m_loadedPlugins.contains(path) )
+        return 0;
+
+    QFile configScript(path);
+    if ( !configScript.open(QIODevice::ReadOnly) ){
+        QCSAConsole::logError(
+            "Error opening js configuration file. Make sure the file is present in " + path + ".");
+        return 2;
     }
 
+    QTextStream configStream(&configScript);
+    QString configSource = configStream.readAll();
+
+    // Marked before evaluation, so plugins depending on each other are not loaded twice
+    m_loadedPlugins.insert(path);
+    m_functions.clear();
+
+    QJSValue evaluateResult = m_engine->evaluate(configSource, configScript.fileName());
+    if ( evaluateResult.isError() ){
+        QCSAConsole::logError("Uncaught javascript exception: " + evaluateResult.toString());
+        return 3;
+    }
+
+    QCSAConsole::log(QCSAConsole::Info2, "Loaded plugin: " + path);
+    if ( source )
+        *source = configSource;
     return 0;
 }
 
@@ -197,7 +326,108 @@ bool QCSAPluginLoader::execute(const QString& jsCode, QJSValue& result){
     if ( !m_engine )
         return false;
 
-    result = m_engine->evaluate(jsCode);
+    QCSAProfiler::CommandScope profilerCommand(jsCode);
+
+    // Plain function calls are invoked directly, which skips compiling the command
+    QString functionName;
+    QJsonArray arguments;
+    if ( parseInvocation(jsCode, &functionName, &arguments) && cachedFunction(functionName).isCallable() )
+        return invoke(functionName, arguments, result);
+
+    // Files changed outside of the session are reparsed before running the command, or once for a whole batch
+    if ( m_codeBase && m_batchFile.isEmpty() )
+        m_codeBase->reparseStaleFiles();
+
+    // Registered plugins are evaluated once a command refers to one of their exported names
+    if ( !m_pluginManifest.isEmpty() && !loadRequiredPlugins(jsCode) )
+        return false;
+
+    m_functions.clear();
+
+    beginCommand();
+    {
+        QCSAProfiler::ScriptScope profilerScript;
+        result = m_engine->evaluate(jsCode);
+    }
+    return finishCommand(result);
+}
+
+bool QCSAPluginLoader::invoke(const QString& functionName, const QJsonArray& arguments, QJSValue& result){
+    if ( !m_engine )
+        return false;
+
+    QCSAProfiler::CommandScope profilerCommand(
+        QCSAProfiler::isEnabled() ? invocationText(functionName, arguments) : QString()
+    );
+
+    if ( m_codeBase && m_batchFile.isEmpty() )
+        m_codeBase->reparseStaleFiles();
+
+    QJSValue function = cachedFunction(functionName);
+    if ( !function.isCallable() ){
+        QCSAConsole::logError("Cannot invoke \'" + functionName + "\'. The function is not defined.");
+        return false;
+    }
+
+    QJSValueList functionArguments;
+    for ( QJsonArray::const_iterator it = arguments.begin(); it != arguments.end(); ++it )
+        functionArguments << m_engine->toScriptValue((*it).toVariant());
+
+    beginCommand();
+    {
+        QCSAProfiler::ScriptScope profilerScript;
+        result = function.call(functionArguments);
+    }
+    return finishCommand(result);
+}
+
+QJSValue QCSAPluginLoader::cachedFunction(const QString& functionName){
+    QHash<QString, QJSValue>::const_iterator it = m_functions.find(functionName);
+    if ( it != m_functions.end() )
+        return it.value();
+
+    if ( !m_pluginManifest.isEmpty() && !loadRequiredPlugins(functionName) )
+        return QJSValue();
+
+    QJSValue function = m_engine->globalObject().property(functionName);
+    if ( function.isCallable() )
+        m_functions.insert(functionName, function);
+    return function;
+}
+
+void QCSAPluginLoader::beginCommand(){
+    if ( m_timeBudget <= 0 )
+        return;
+
+    m_modifiedBeforeCommand.clear();
+    if ( m_codeBase ){
+        const QList<ast::QASTFile*>& files = m_codeBase->astFiles();
+        for ( QList<ast::QASTFile*>::const_iterator it = files.begin(); it != files.end(); ++it ){
+            if ( (*it)->hasModifiers() )
+                m_modifiedBeforeCommand.insert(*it);
+        }
+    }
+
+    if ( !m_watchdog )
+        m_watchdog = new QCSAScriptWatchdog(m_engine, this);
+    m_watchdog->arm(m_timeBudget);
+}
+
+bool QCSAPluginLoader::finishCommand(const QJSValue& result){
+    // A command that finished right as its budget ran out completed anyway, and is kept
+    if ( m_watchdog && m_watchdog->disarm() && result.isError() ){
+        discardCommandModifiers();
+        QCSAConsole::logError(
+            "Command interrupted after exceeding its time budget of " + QString::number(m_timeBudget) +
+            "ms. The changes it made were discarded."
+        );
+        return false;
+    }
+
+    // Deferred saves are written once the command finishes
+    if ( m_codeBase )
+        m_codeBase->flush();
+
     if ( result.isError() ){
         QCSAConsole::logError("Uncaught javascript exception: " + result.toString());
         return false;
@@ -206,15 +436,133 @@ bool QCSAPluginLoader::execute(const QString& jsCode, QJSValue& result){
     return true;
 }
 
+void QCSAPluginLoader::discardCommandModifiers(){
+    if ( !m_codeBase )
+        return;
+
+    // Edits held for the files a batch already went through are kept, as they were reported as done. The batch file
+    // is only edited by its own command, so it's cleared either way.
+    const QList<ast::QASTFile*>& files = m_codeBase->astFiles();
+    for ( QList<ast::QASTFile*>::const_iterator it = files.begin(); it != files.end(); ++it ){
+        ast::QASTFile* file = *it;
+        if ( file->hasModifiers() && (!m_modifiedBeforeCommand.contains(file) || file->identifier() == m_batchFile) )
+            file->clearModifiers();
+    }
+    m_modifiedBeforeCommand.clear();
+}
+
+int QCSAPluginLoader::executeBatch(const QString& jsCode, const QStringList& files, int jobs){
+    if ( !m_engine || !m_codeBase )
+        return files.size();
+
+    m_codeBase->reparseStaleFiles();
+
+    if ( jobs > 1 ){
+        if ( m_workerPool )
+            return executeParallelBatch(jsCode, files, jobs);
+        QCSAConsole::logError("The worker pool is not loaded. Running the batch on a single thread.");
+    }
+
+    // Saves are held until the command ran for every file, so edited files are written and reparsed together
+    bool saveHeld = m_codeBase->isSaveHeld();
+    m_codeBase->setSaveHeld(true);
+
+    int failures = 0;
+    for ( QStringList::const_iterator it = files.begin(); it != files.end(); ++it ){
+        // Looked up for each command, since a command may reparse files
+        ast::QASTFile* file = m_codeBase->findFile(*it);
+        if ( !file ){
+            QCSAConsole::logError(*it + ": The file has not been parsed.");
+            ++failures;
+            continue;
+        }
+
+        m_batchFile = *it;
+        m_codeBase->selectNode(file);
+        m_engine->globalObject().setProperty("file", file->scriptValue(m_engine));
+
+        QJSValue result;
+        if ( execute(jsCode, result) ){
+            QCSAConsole::log(
+                QCSAConsole::General, *it + ": " + (result.isUndefined() ? QString("done") : result.toString())
+            );
+        } else {
+            QCSAConsole::logError(*it + ": Command failed.");
+            ++failures;
+        }
+    }
+
+    m_batchFile = QString();
+    m_engine->globalObject().deleteProperty("file");
+
+    m_codeBase->setSaveHeld(saveHeld);
+    return failures;
+}
+
+int QCSAPluginLoader::executeParallelBatch(const QString& jsCode, const QStringList& files, int jobs){
+    QList<ast::QASTFile*> astFiles;
+    for ( QStringList::const_iterator it = files.begin(); it != files.end(); ++it )
+        astFiles.append(m_codeBase->findFile(*it));
+
+    // Each worker compiles the command once, into a function called with the file and its path
+    QString expression = jsCode.trimmed();
+
+    // Workers only query the code base. Files whose command tries to edit them are reported as failed by the pool.
+    int maxWorkers = m_workerPool->maxWorkers();
+    m_workerPool->setMaxWorkers(jobs);
+
+    QVector<QVariant> results;
+    QVector<QString>  errors;
+    beginCommand();
+    m_workerPool->runExpression(astFiles, expression, results, errors);
+    if ( m_watchdog && m_watchdog->disarm() ){
+        QCSAConsole::logError(
+            "Batch interrupted after exceeding its time budget of " + QString::number(m_timeBudget) + "ms."
+        );
+    }
+
+    m_workerPool->setMaxWorkers(maxWorkers);
+
+    int failures = 0;
+    for ( int i = 0; i < files.size(); ++i ){
+        if ( !astFiles[i] ){
+            QCSAConsole::logError(files[i] + ": The file has not been parsed.");
+            ++failures;
+        } else if ( !errors[i].isEmpty() ){
+            QCSAConsole::logError(files[i] + ": Uncaught javascript exception: " + errors[i]);
+            ++failures;
+        } else {
+            QCSAConsole::log(
+                QCSAConsole::General, files[i] + ": " + (results[i].isNull() ? QString("done") : results[i].toString())
+            );
+        }
+    }
+    return failures;
+}
+
 void QCSAPluginLoader::setContextObject(const QString& name, QObject* object){
+    // Ownership is set before wrapping, and only by the thread owning the object. Worker engines wrap shared objects
+    // that were prepared for them by the worker pool.
+    if ( object->thread() == QThread::currentThread() )
+        QQmlEngine::setObjectOwnership(object, QQmlEngine::CppOwnership);
     m_engine->globalObject().setProperty(name, m_engine->newQObject(object));
-    QQmlEngine::setObjectOwnership(object, QQmlEngine::CppOwnership);
 }
 
 void QCSAPluginLoader::setContextOwnedObject(const QString &name, QObject *object){
     m_engine->globalObject().setProperty(name, m_engine->newQObject(object));
 }
 
+void QCSAPluginLoader::setTimeBudget(int budget){
+    if ( budget > 0 && !QCSAScriptWatchdog::isSupported() )
+        QCSAConsole::logError("Script time budgets require Qt 5.14 or later. Commands will not be interrupted.");
+    m_timeBudget = budget;
+}
+
+void QCSAPluginLoader::setCodeBase(QCodeBase* codeBase){
+    m_codeBase = codeBase;
+    setContextObject("codeBase", codeBase);
+}
+
 bool QCSAPluginLoader::execute(const QString& jsCode){
     QJSValue result;
     return execute(jsCode, result);
@@ -19,15 +19,24 @@
 #define QCSAPLUGINLOADER_HPP
 
 #include "QCSAGlobal.hpp"
+#include "QCSAPluginManifest.hpp"
 #include <QString>
+#include <QStringList>
 #include <QObject>
+#include <QSet>
+#include <QHash>
+#include <QJSValue>
+#include <QJsonArray>
 
-class QJSValue;
 class QJSEngine;
 
 namespace csa{
 
 class QCodeBase;
+class QCSAScriptWatchdog;
+class QCSAWorkerPool;
+
+namespace ast{ class QASTFile; }
 
 class Q_CSA_EXPORT QCSAPluginLoader : public QObject{
 
@@ -42,24 +51,63 @@ public:
     bool loadNodeCollection();
     bool loadNodesFunction();
     bool loadFileFunctions();
+    bool loadWorkerPool(const QString& pluginPath, int maxWorkers = -1);
     int loadPlugins(const QString &path);
+    int registerPlugins(const QString& path);
+    bool loadRequiredPlugins(const QString& jsCode);
 
     bool execute(const QString &jsCode, QJSValue& result);
+    bool invoke(const QString& functionName, const QJsonArray& arguments, QJSValue& result);
+    int executeBatch(const QString& jsCode, const QStringList& files, int jobs = 1);
 
     void setContextObject(const QString& name, QObject* object);
     void setContextOwnedObject(const QString& name, QObject* object);
+    void setCodeBase(QCodeBase* codeBase);
+
+    void setTimeBudget(int budget);
+    int timeBudget() const;
 
 public slots:
     bool execute(const QString& jsCode);
 
 private:
+    int evaluatePlugin(const QString& path, QString* source = 0);
+    QJSValue cachedFunction(const QString& functionName);
+    void beginCommand();
+    bool finishCommand(const QJSValue& result);
+    void discardCommandModifiers();
+    int executeParallelBatch(const QString& jsCode, const QStringList& files, int jobs);
+
     QJSEngine*          m_engine;
+    QCodeBase*          m_codeBase;
+
+    QCSAPluginManifest  m_pluginManifest;
+    QSet<QString>       m_loadedPlugins;
+
+    // Global functions looked up by invoke(), cleared whenever evaluated code could redefine them
+    QHash<QString, QJSValue> m_functions;
+
+    // Commands running longer than the budget, in milliseconds, are interrupted
+    int                 m_timeBudget;
+    QCSAScriptWatchdog* m_watchdog;
+
+    // Files with pending edits when the running command started, which an interrupted command leaves untouched
+    QSet<ast::QASTFile*> m_modifiedBeforeCommand;
+
+    QCSAWorkerPool*     m_workerPool;
+
+    // File the running batch command was selected for, empty outside of batches
+    QString             m_batchFile;
 };
 
 inline QJSEngine* QCSAPluginLoader::engine(){
     return m_engine;
 }
 
+inline int QCSAPluginLoader::timeBudget() const{
+    return m_timeBudget;
+}
+
 }// namespace
 
 #endif // QCSAPLUGINLOADER_HPP
@@ -0,0 +1,226 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#include "QCSAPluginManifest.hpp"
+#include "QCSAConsole.hpp"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+#include <QTextStream>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QRegularExpression>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QSet>
+
+namespace csa{
+
+namespace{
+
+QString readPluginSource(const QString& path){
+    QFile file(path);
+    if ( !file.open(QIODevice::ReadOnly) )
+        return QString();
+    QTextStream stream(&file);
+    return stream.readAll();
+}
+
+}// namespace
+
+QCSAPluginManifest::QCSAPluginManifest(const QString& cacheDir)
+    : m_cacheDir(cacheDir)
+{
+    if ( m_cacheDir.isEmpty() )
+        m_cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/plugins";
+}
+
+QCSAPluginManifest::~QCSAPluginManifest(){
+}
+
+bool QCSAPluginManifest::scan(const QString& path){
+    clear();
+
+    QFileInfo pathInfo(path);
+    if ( !pathInfo.exists() ){
+        QCSAConsole::logError("Path does not exist: " + path + ".");
+        return false;
+    }
+
+    QStringList pluginPaths;
+    if ( pathInfo.isDir() ){
+        QDirIterator it(path, QDirIterator::Subdirectories);
+        while ( it.hasNext() ){
+            it.next();
+            if ( it.fileInfo().suffix() == "js" )
+                pluginPaths.append(it.filePath());
+        }
+    } else {
+        pluginPaths.append(path);
+    }
+
+    QString cachedManifestPath = manifestPath(pathInfo.absoluteFilePath());
+    QHash<QString, Plugin> cachedPlugins;
+    read(cachedManifestPath, cachedPlugins);
+
+    // Plugins are only read when their stamp differs from the cached one
+    bool changed = cachedPlugins.size() != pluginPaths.size();
+    for ( QStringList::const_iterator it = pluginPaths.begin(); it != pluginPaths.end(); ++it ){
+        QFileInfo pluginInfo(*it);
+
+        Plugin plugin = cachedPlugins.value(*it);
+        if ( plugin.path.isEmpty() ||
+             plugin.size != pluginInfo.size() ||
+             plugin.lastModified != pluginInfo.lastModified() )
+        {
+            plugin.path         = *it;
+            plugin.size         = pluginInfo.size();
+            plugin.lastModified = pluginInfo.lastModified();
+            plugin.names        = exportedNames(readPluginSource(*it));
+            changed = true;
+        }
+
+        m_plugins.append(plugin);
+        for ( QStringList::const_iterator nameIt = plugin.names.begin(); nameIt != plugin.names.end(); ++nameIt ){
+            if ( !m_exports.contains(*nameIt) )
+                m_exports[*nameIt] = plugin.path;
+        }
+    }
+
+    if ( changed ){
+        if ( !QDir().mkpath(m_cacheDir) || !write(cachedManifestPath) )
+            QCSAConsole::log(QCSAConsole::Info2, "Failed to write plugin manifest for: " + path);
+    }
+
+    QCSAConsole::log(
+        QCSAConsole::Info2,
+        "Plugin manifest: " + QString::number(m_plugins.size()) + " plugins, " +
+        QString::number(m_exports.size()) + " exported names" + (changed ? "" : " (cached)")
+    );
+    return true;
+}
+
+void QCSAPluginManifest::clear(){
+    m_plugins.clear();
+    m_exports.clear();
+}
+
+QString QCSAPluginManifest::pluginFile(const QString& name) const{
+    return m_exports.value(name);
+}
+
+QStringList QCSAPluginManifest::pluginFiles() const{
+    QStringList files;
+    for ( QList<Plugin>::const_iterator it = m_plugins.begin(); it != m_plugins.end(); ++it )
+        files.append(it->path);
+    return files;
+}
+
+QStringList QCSAPluginManifest::requiredPluginFiles(const QString& jsCode) const{
+    static QRegularExpression identifierExpression("[A-Za-z_$][\\w$]*");
+
+    QStringList files;
+    QSet<QString> visitedNames;
+
+    QRegularExpressionMatchIterator it = identifierExpression.globalMatch(jsCode);
+    while ( it.hasNext() ){
+        QString name = it.next().captured();
+        if ( visitedNames.contains(name) )
+            continue;
+        visitedNames.insert(name);
+
+        QString file = m_exports.value(name);
+        if ( !file.isEmpty() && !files.contains(file) )
+            files.append(file);
+    }
+    return files;
+}
+
+QStringList QCSAPluginManifest::exportedNames(const QString& source){
+    // Plugins declare their functions at the start of a line, nested functions are indented
+    static QRegularExpression functionExpression(
+        "^function\\s+([A-Za-z_$][\\w$]*)\\s*\\(", QRegularExpression::MultilineOption
+    );
+    static QRegularExpression methodExpression("\\.prototype\\.([A-Za-z_$][\\w$]*)\\s*=");
+
+    QStringList names;
+    QRegularExpressionMatchIterator functionIt = functionExpression.globalMatch(source);
+    while ( functionIt.hasNext() )
+        names.append(functionIt.next().captured(1));
+
+    QRegularExpressionMatchIterator methodIt = methodExpression.globalMatch(source);
+    while ( methodIt.hasNext() )
+        names.append(methodIt.next().captured(1));
+
+    names.removeDuplicates();
+    return names;
+}
+
+QString QCSAPluginManifest::manifestPath(const QString& path) const{
+    return m_cacheDir + "/" + QString::fromLatin1(
+        QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Md5).toHex()
+    ) + ".json";
+}
+
+bool QCSAPluginManifest::read(const QString& manifestPath, QHash<QString, Plugin>& plugins) const{
+    QFile file(manifestPath);
+    if ( !file.open(QIODevice::ReadOnly) )
+        return false;
+
+    QJsonArray pluginArray = QJsonDocument::fromJson(file.readAll()).object()["plugins"].toArray();
+    for ( QJsonArray::const_iterator it = pluginArray.begin(); it != pluginArray.end(); ++it ){
+        QJsonObject pluginObject = (*it).toObject();
+
+        Plugin plugin;
+        plugin.path         = pluginObject["path"].toString();
+        plugin.size         = static_cast<qint64>(pluginObject["size"].toDouble());
+        plugin.lastModified = QDateTime::fromMSecsSinceEpoch(
+            static_cast<qint64>(pluginObject["lastModified"].toDouble())
+        );
+
+        QJsonArray names = pluginObject["names"].toArray();
+        for ( QJsonArray::const_iterator nameIt = names.begin(); nameIt != names.end(); ++nameIt )
+            plugin.names.append((*nameIt).toString());
+
+        plugins[plugin.path] = plugin;
+    }
+    return !plugins.isEmpty();
+}
+
+bool QCSAPluginManifest::write(const QString& manifestPath) const{
+    QJsonArray pluginArray;
+    for ( QList<Plugin>::const_iterator it = m_plugins.begin(); it != m_plugins.end(); ++it ){
+        QJsonObject pluginObject;
+        pluginObject["path"]         = it->path;
+        pluginObject["size"]         = static_cast<double>(it->size);
+        pluginObject["lastModified"] = static_cast<double>(it->lastModified.toMSecsSinceEpoch());
+        pluginObject["names"]        = QJsonArray::fromStringList(it->names);
+        pluginArray.append(pluginObject);
+    }
+
+    QJsonObject manifest;
+    manifest["plugins"] = pluginArray;
+
+    QFile file(manifestPath);
+    if ( !file.open(QIODevice::WriteOnly) )
+        return false;
+    return file.write(QJsonDocument(manifest).toJson()) != -1;
+}
+
+}// namespace
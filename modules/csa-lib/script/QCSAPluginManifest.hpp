@@ -0,0 +1,75 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#ifndef QCSAPLUGINMANIFEST_HPP
+#define QCSAPLUGINMANIFEST_HPP
+
+#include "QCSAGlobal.hpp"
+#include <QStringList>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+
+namespace csa{
+
+// Maps the names exported by plugin scripts to the files declaring them, so plugins can be evaluated only once a
+// command uses them. Exported names are top level functions and NodeCollection prototype methods. The manifest is
+// cached as json per plugin directory, and only files that changed since the last scan are read again.
+class Q_CSA_EXPORT QCSAPluginManifest{
+
+public:
+    explicit QCSAPluginManifest(const QString& cacheDir = "");
+    ~QCSAPluginManifest();
+
+    bool scan(const QString& path);
+    void clear();
+
+    bool isEmpty() const;
+
+    QString pluginFile(const QString& name) const;
+    QStringList pluginFiles() const;
+    QStringList requiredPluginFiles(const QString& jsCode) const;
+
+    static QStringList exportedNames(const QString& source);
+
+private:
+    class Plugin{
+    public:
+        Plugin() : size(-1){}
+
+        QString     path;
+        qint64      size;
+        QDateTime   lastModified;
+        QStringList names;
+    };
+
+    QString manifestPath(const QString& path) const;
+    bool read(const QString& manifestPath, QHash<QString, Plugin>& plugins) const;
+    bool write(const QString& manifestPath) const;
+
+    QString                 m_cacheDir;
+    QList<Plugin>           m_plugins;
+    QHash<QString, QString> m_exports;
+};
+
+inline bool QCSAPluginManifest::isEmpty() const{
+    return m_plugins.isEmpty();
+}
+
+}// namespace
+
+#endif // QCSAPLUGINMANIFEST_HPP
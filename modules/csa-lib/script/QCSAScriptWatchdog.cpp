@@ -0,0 +1,104 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#include "QCSAScriptWatchdog.hpp"
+#include <QJSEngine>
+
+namespace csa{
+
+QCSAScriptWatchdog::QCSAScriptWatchdog(QJSEngine* engine, QObject* parent)
+    : QThread(parent)
+    , m_engine(engine)
+    , m_budget(0)
+    , m_armed(false)
+    , m_interrupted(false)
+    , m_stopped(false)
+{
+}
+
+QCSAScriptWatchdog::~QCSAScriptWatchdog(){
+    m_mutex.lock();
+    m_stopped = true;
+    m_condition.wakeAll();
+    m_mutex.unlock();
+    wait();
+}
+
+bool QCSAScriptWatchdog::isSupported(){
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void QCSAScriptWatchdog::arm(int budget){
+    if ( budget <= 0 || !isSupported() )
+        return;
+
+    if ( !isRunning() )
+        start();
+
+    QMutexLocker lock(&m_mutex);
+    m_budget      = budget;
+    m_armed       = true;
+    m_interrupted = false;
+    m_timer.start();
+    m_condition.wakeAll();
+}
+
+bool QCSAScriptWatchdog::disarm(){
+    QMutexLocker lock(&m_mutex);
+    m_armed = false;
+    m_condition.wakeAll();
+
+    bool interrupted = m_interrupted;
+    m_interrupted = false;
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    // The engine stays interrupted until reset, which would abort every following command
+    if ( interrupted )
+        m_engine->setInterrupted(false);
+#endif
+
+    return interrupted;
+}
+
+void QCSAScriptWatchdog::run(){
+    QMutexLocker lock(&m_mutex);
+    while ( !m_stopped ){
+        if ( !m_armed ){
+            m_condition.wait(&m_mutex);
+            continue;
+        }
+
+        qint64 remaining = m_budget - m_timer.elapsed();
+        if ( remaining > 0 ){
+            // Woken up early when the command finishes or a new one is armed
+            m_condition.wait(&m_mutex, static_cast<unsigned long>(remaining));
+            continue;
+        }
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        m_engine->setInterrupted(true);
+#endif
+        m_interrupted = true;
+        m_armed       = false;
+    }
+}
+
+}// namespace
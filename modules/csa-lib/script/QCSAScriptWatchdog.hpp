@@ -0,0 +1,62 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#ifndef QCSASCRIPTWATCHDOG_HPP
+#define QCSASCRIPTWATCHDOG_HPP
+
+#include "QCSAGlobal.hpp"
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+
+class QJSEngine;
+
+namespace csa{
+
+// Interrupts the script running on an engine once it exceeds its time budget. The watchdog is armed before a
+// command starts, and disarmed once it returns, which reports whether the command was interrupted.
+class Q_CSA_EXPORT QCSAScriptWatchdog : public QThread{
+
+public:
+    explicit QCSAScriptWatchdog(QJSEngine* engine, QObject* parent = 0);
+    ~QCSAScriptWatchdog();
+
+    static bool isSupported();
+
+    void arm(int budget);
+    bool disarm();
+
+protected:
+    void run();
+
+private:
+    QJSEngine*     m_engine;
+
+    QMutex         m_mutex;
+    QWaitCondition m_condition;
+    QElapsedTimer  m_timer;
+
+    int            m_budget;
+    bool           m_armed;
+    bool           m_interrupted;
+    bool           m_stopped;
+};
+
+}// namespace
+
+#endif // QCSASCRIPTWATCHDOG_HPP
@@ -0,0 +1,356 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#include "QCSAWorkerPool.hpp"
+#include "QCSAPluginLoader.hpp"
+#include "QCSAConsole.hpp"
+#include "QCodeBase.hpp"
+#include "QASTFile.hpp"
+#include <QJSEngine>
+#include <QQmlEngine>
+#include <QRunnable>
+#include <QHash>
+#include <QPointer>
+#include <QThreadStorage>
+
+namespace csa{
+
+using namespace ast;
+
+namespace{
+
+// Milliseconds between checks for an interrupted command while waiting for the workers
+const int WorkerInterruptCheckInterval = 10;
+
+// Operations rejected on each thread, counted so tasks can tell whether their function tried to edit the code base
+Q_GLOBAL_STATIC(QThreadStorage<int>, rejectedOperations)
+
+// Engine of the worker on each thread, which nodes called from a worker hand their wrappers to
+Q_GLOBAL_STATIC(QThreadStorage<QPointer<QJSEngine> >, workerEngines)
+
+// Wrapping an object for the first time writes to its declarative data, which is shared by all engines. Objects
+// workers can reach are given their ownership and a wrapper in the pool's engine, from the thread owning them, so the
+// worker engines only read that data and keep their own wrappers.
+void prepareScriptObject(QJSEngine* engine, QObject* object){
+    QQmlEngine::setObjectOwnership(object, QQmlEngine::CppOwnership);
+    engine->newQObject(object);
+}
+
+void prepareScriptObjects(QJSEngine* engine, QObject* object){
+    prepareScriptObject(engine, object);
+    const QObjectList& children = object->children();
+    for ( QObjectList::const_iterator it = children.begin(); it != children.end(); ++it )
+        prepareScriptObjects(engine, *it);
+}
+
+}// namespace
+
+// QCSAWorkerPool::Worker Definitions
+// ----------------------------------
+
+class QCSAWorkerPool::Worker{
+
+public:
+    Worker(QCodeBase* codeBase, const QString& pluginPath);
+    ~Worker();
+
+    QJSEngine* engine();
+    QJSValue function(const QString& functionSource);
+    QJSValue expressionFunction(const QString& expression);
+
+private:
+    QJSEngine*               m_engine;
+    QCSAPluginLoader*        m_loader;
+    QHash<QString, QJSValue> m_functions;
+    QHash<QString, QJSValue> m_expressionFunctions;
+};
+
+QCSAWorkerPool::Worker::Worker(QCodeBase* codeBase, const QString& pluginPath)
+    : m_engine(new QJSEngine)
+    , m_loader(new QCSAPluginLoader(m_engine))
+{
+    workerEngines()->setLocalData(m_engine);
+
+    m_loader->setCodeBase(codeBase);
+    m_loader->loadNodeCollection();
+    m_loader->loadNodesFunction();
+    m_loader->loadFileFunctions();
+
+    // Plugins are evaluated once a mapped function refers to them
+    if ( !pluginPath.isEmpty() )
+        m_loader->registerPlugins(pluginPath);
+}
+
+QCSAWorkerPool::Worker::~Worker(){
+    delete m_loader;
+    delete m_engine;
+}
+
+QJSEngine* QCSAWorkerPool::Worker::engine(){
+    return m_engine;
+}
+
+QJSValue QCSAWorkerPool::Worker::function(const QString& functionSource){
+    QHash<QString, QJSValue>::const_iterator it = m_functions.find(functionSource);
+    if ( it != m_functions.end() )
+        return it.value();
+
+    if ( !m_loader->loadRequiredPlugins(functionSource) )
+        return QJSValue();
+
+    QJSValue function = m_engine->evaluate("(" + functionSource + ")");
+    if ( function.isCallable() )
+        m_functions.insert(functionSource, function);
+    return function;
+}
+
+QJSValue QCSAWorkerPool::Worker::expressionFunction(const QString& expression){
+    QHash<QString, QJSValue>::const_iterator it = m_expressionFunctions.find(expression);
+    if ( it != m_expressionFunctions.end() )
+        return it.value();
+
+    if ( !m_loader->loadRequiredPlugins(expression) )
+        return QJSValue();
+
+    // The expression is compiled as the body of its own function, so it can't reach outside of it. The line break
+    // ends a trailing comment.
+    QJSValue function = m_engine->globalObject().property("Function").callAsConstructor(
+        QJSValueList() << QJSValue("file") << QJSValue("path") << QJSValue("return " + expression + "\n;")
+    );
+    if ( function.isCallable() )
+        m_expressionFunctions.insert(expression, function);
+    return function;
+}
+
+// QCSAWorkerPool::Task Definitions
+// --------------------------------
+
+class QCSAWorkerPool::Task : public QRunnable{
+
+public:
+    Task(
+            QCSAWorkerPool* pool,
+            QASTFile* file,
+            const QString& source,
+            SourceType sourceType,
+            QVariant* result,
+            QString* error)
+        : m_pool(pool)
+        , m_file(file)
+        , m_source(source)
+        , m_sourceType(sourceType)
+        , m_result(result)
+        , m_error(error)
+    {
+    }
+
+    void run();
+
+private:
+    QCSAWorkerPool* m_pool;
+    QASTFile*       m_file;
+    QString         m_source;
+    SourceType      m_sourceType;
+    QVariant*       m_result;
+    QString*        m_error;
+};
+
+void QCSAWorkerPool::Task::run(){
+    Worker* worker = m_pool->threadWorker();
+
+    QJSValue function =
+        m_sourceType == ExpressionSource ? worker->expressionFunction(m_source) : worker->function(m_source);
+    if ( function.isError() ){
+        *m_error = function.toString();
+        return;
+    }
+    if ( !function.isCallable() ){
+        *m_error = "The mapped value is not a function.";
+        return;
+    }
+
+    int rejectedBefore = rejectedOperations()->localData();
+    QJSValue result = function.call(QJSValueList() << m_file->scriptValue(worker->engine()) << m_file->identifier());
+    if ( result.isError() ){
+        *m_error = result.toString();
+        return;
+    }
+
+    // Edits are refused without an exception, so the function would otherwise appear to have succeeded
+    if ( rejectedOperations()->localData() != rejectedBefore ){
+        *m_error = "The function tried to change the code base, which is read only for workers.";
+        return;
+    }
+
+    // Converted here, since the value belongs to the engine of this thread
+    *m_result = result.toVariant();
+}
+
+// QCSAWorkerPool Definitions
+// --------------------------
+
+QCSAWorkerPool::QCSAWorkerPool(
+        QJSEngine* engine,
+        QCodeBase* codeBase,
+        const QString& pluginPath,
+        int maxWorkers,
+        QObject* parent)
+    : QObject(parent)
+    , m_engine(engine)
+    , m_codeBase(codeBase)
+    , m_pluginPath(pluginPath)
+{
+    prepareScriptObject(m_engine, m_codeBase);
+    prepareScriptObject(m_engine, &QCSAConsole::instance());
+
+    // Threads are kept alive, so their engines are only set up once
+    m_threadPool.setExpiryTimeout(-1);
+    if ( maxWorkers > 0 )
+        m_threadPool.setMaxThreadCount(maxWorkers);
+}
+
+QCSAWorkerPool::~QCSAWorkerPool(){
+    m_threadPool.waitForDone();
+}
+
+void QCSAWorkerPool::run(
+        const QList<QASTFile*>& files,
+        const QString& functionSource,
+        QVector<QVariant>& results,
+        QVector<QString>& errors)
+{
+    runTasks(files, functionSource, FunctionSource, results, errors);
+}
+
+void QCSAWorkerPool::runExpression(
+        const QList<QASTFile*>& files,
+        const QString& expression,
+        QVector<QVariant>& results,
+        QVector<QString>& errors)
+{
+    runTasks(files, expression, ExpressionSource, results, errors);
+}
+
+void QCSAWorkerPool::runTasks(
+        const QList<QASTFile*>& files,
+        const QString& source,
+        SourceType sourceType,
+        QVector<QVariant>& results,
+        QVector<QString>& errors)
+{
+    // Pending edits are written before the workers start, and the tree stays unchanged until they are done
+    m_codeBase->flush();
+
+    // Workers may reach any parsed file through the code base, not only the ones they were given. Wrappers are not
+    // kept between runs, since the tree can change in the meantime.
+    const QObjectList& codeBaseFiles = m_codeBase->children();
+    for ( QObjectList::const_iterator it = codeBaseFiles.begin(); it != codeBaseFiles.end(); ++it )
+        prepareScriptObjects(m_engine, *it);
+
+    // Files cache their decoded content and offset mapping on first use, which is done here instead of by the workers
+    const QList<QASTFile*>& astFiles = m_codeBase->astFiles();
+    for ( QList<QASTFile*>::const_iterator it = astFiles.begin(); it != astFiles.end(); ++it )
+        (*it)->prepareConcurrentReads();
+
+    results = QVector<QVariant>(files.size());
+    errors  = QVector<QString>(files.size());
+    for ( int i = 0; i < files.size(); ++i ){
+        if ( files[i] )
+            m_threadPool.start(new Task(this, files[i], source, sourceType, &results[i], &errors[i]));
+    }
+    waitForWorkers();
+}
+
+QJSValue QCSAWorkerPool::map(const QJSValue& files, const QString& functionSource){
+    QList<QASTFile*> astFiles;
+    if ( files.isArray() ){
+        int length = files.property("length").toInt();
+        for ( int i = 0; i < length; ++i ){
+            QJSValue file = files.property(static_cast<quint32>(i));
+            QASTFile* astFile = qobject_cast<QASTFile*>(file.toQObject());
+            if ( !astFile && file.isString() )
+                astFile = m_codeBase->findFile(file.toString());
+            if ( !astFile )
+                QCSAConsole::logError("Cannot map file \'" + file.toString() + "\'. The file has not been parsed.");
+            astFiles.append(astFile);
+        }
+    }
+
+    QVector<QVariant> results;
+    QVector<QString>  errors;
+    run(astFiles, functionSource, results, errors);
+
+    QJSValue result = m_engine->newArray(static_cast<uint>(astFiles.size()));
+    for ( int i = 0; i < astFiles.size(); ++i ){
+        if ( !errors[i].isEmpty() ){
+            QCSAConsole::logError(
+                "Uncaught javascript exception in parallelMap for \'" + astFiles[i]->identifier() + "\': " + errors[i]
+            );
+        }
+        result.setProperty(static_cast<quint32>(i), m_engine->toScriptValue(results[i]));
+    }
+    return result;
+}
+
+QCSAWorkerPool::Worker* QCSAWorkerPool::threadWorker(){
+    if ( !m_workers.hasLocalData() ){
+        Worker* worker = new Worker(m_codeBase, m_pluginPath);
+        m_workers.setLocalData(worker);
+
+        QMutexLocker lock(&m_workerEnginesMutex);
+        m_workerEngines.append(worker->engine());
+    }
+    return m_workers.localData();
+}
+
+void QCSAWorkerPool::waitForWorkers(){
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    // The pool's engine is interrupted by the watchdog once the command exceeds its time budget. The waiting thread
+    // passes the interruption on to the workers, and resets them once they stopped.
+    while ( !m_threadPool.waitForDone(WorkerInterruptCheckInterval) ){
+        if ( m_engine->isInterrupted() ){
+            setWorkersInterrupted(true);
+            m_threadPool.waitForDone();
+            setWorkersInterrupted(false);
+            return;
+        }
+    }
+#else
+    m_threadPool.waitForDone();
+#endif
+}
+
+void QCSAWorkerPool::rejectOperation(const QString& message){
+    ++rejectedOperations()->localData();
+    QCSAConsole::logError(message);
+}
+
+QJSEngine* QCSAWorkerPool::threadEngine(){
+    return workerEngines()->hasLocalData() ? workerEngines()->localData().data() : 0;
+}
+
+void QCSAWorkerPool::setWorkersInterrupted(bool interrupted){
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    QMutexLocker lock(&m_workerEnginesMutex);
+    for ( QList<QJSEngine*>::iterator it = m_workerEngines.begin(); it != m_workerEngines.end(); ++it )
+        (*it)->setInterrupted(interrupted);
+#else
+    Q_UNUSED(interrupted);
+#endif
+}
+
+}// namespace
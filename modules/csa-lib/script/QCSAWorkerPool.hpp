@@ -0,0 +1,127 @@
+/****************************************************************************
+**
+** Copyright (C) 2014-2015 Dinu SV.
+** (contact: mail@dinusv.com)
+** This file is part of C++ Snippet Assist application.
+**
+** GNU General Public License Usage
+** 
+** This file may be used under the terms of the GNU General Public License 
+** version 3.0 as published by the Free Software Foundation and appearing 
+** in the file LICENSE.GPL included in the packaging of this file.  Please 
+** review the following information to ensure the GNU General Public License 
+** version 3.0 requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#ifndef QCSAWORKERPOOL_HPP
+#define QCSAWORKERPOOL_HPP
+
+#include "QCSAGlobal.hpp"
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QJSValue>
+#include <QVariant>
+#include <QVector>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QMutex>
+
+class QJSEngine;
+
+namespace csa{
+
+class QCodeBase;
+namespace ast{ class QASTFile; }
+
+// Runs script functions over parsed files on a pool of threads. Each thread owns its own engine with the plugins
+// registered, and sees the shared code base as read only: the engine the pool was created for keeps exclusive
+// control over edits, saves and reparses, and waits for the workers to finish before continuing.
+class Q_CSA_EXPORT QCSAWorkerPool : public QObject{
+
+    Q_OBJECT
+
+public:
+    QCSAWorkerPool(
+            QJSEngine* engine,
+            QCodeBase* codeBase,
+            const QString& pluginPath,
+            int maxWorkers = -1,
+            QObject* parent = 0);
+    ~QCSAWorkerPool();
+
+    int maxWorkers() const;
+    void setMaxWorkers(int maxWorkers);
+
+    // Logs an operation a worker attempted on the read only code base. The task the worker runs fails once it returns.
+    static void rejectOperation(const QString& message);
+
+    // Engine of the worker running on the calling thread, or null outside of the workers
+    static QJSEngine* threadEngine();
+
+    void run(
+        const QList<ast::QASTFile*>& files,
+        const QString& functionSource,
+        QVector<QVariant>& results,
+        QVector<QString>& errors);
+
+    // Evaluates the expression for each file, with the file and its path available as 'file' and 'path'
+    void runExpression(
+        const QList<ast::QASTFile*>& files,
+        const QString& expression,
+        QVector<QVariant>& results,
+        QVector<QString>& errors);
+
+public slots:
+    QJSValue map(const QJSValue& files, const QString& functionSource);
+
+private:
+    // prevent copy
+    QCSAWorkerPool(const QCSAWorkerPool& other);
+    QCSAWorkerPool& operator=(const QCSAWorkerPool& other);
+
+    class Worker;
+    class Task;
+
+    enum SourceType{
+        FunctionSource,
+        ExpressionSource
+    };
+
+    void runTasks(
+        const QList<ast::QASTFile*>& files,
+        const QString& source,
+        SourceType sourceType,
+        QVector<QVariant>& results,
+        QVector<QString>& errors);
+    Worker* threadWorker();
+    void waitForWorkers();
+    void setWorkersInterrupted(bool interrupted);
+
+    QJSEngine* m_engine;
+    QCodeBase* m_codeBase;
+    QString    m_pluginPath;
+
+    // Engines of the workers created so far, which live as long as the pool
+    QMutex            m_workerEnginesMutex;
+    QList<QJSEngine*> m_workerEngines;
+
+    // Workers are deleted by the threads owning them, which exit when the thread pool is destroyed. The storage
+    // needs to outlive the pool for that.
+    QThreadStorage<Worker*> m_workers;
+    QThreadPool             m_threadPool;
+};
+
+inline int QCSAWorkerPool::maxWorkers() const{
+    return m_threadPool.maxThreadCount();
+}
+
+inline void QCSAWorkerPool::setMaxWorkers(int maxWorkers){
+    m_threadPool.setMaxThreadCount(maxWorkers);
+}
+
+}// namespace
+
+#endif // QCSAWORKERPOOL_HPP
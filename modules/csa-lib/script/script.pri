@@ -9,7 +9,11 @@ HEADERS += \
     $$PWD/QASTCollapsibleModel.hpp \
     $$PWD/QCSACompletionSet.hpp \
     $$PWD/QCSACompletionModel.hpp \
-    $$PWD/QJsonConvert.hpp
+    $$PWD/QJsonConvert.hpp \
+    $$PWD/QCSANodeCollection.hpp \
+    $$PWD/QCSAPluginManifest.hpp \
+    $$PWD/QCSAWorkerPool.hpp \
+    $$PWD/QCSAScriptWatchdog.hpp
 
 SOURCES += \
     $$PWD/QAnnotatedTokenConvert.cpp \
@@ -20,4 +24,8 @@ SOURCES += \
     $$PWD/QASTCollapsibleModel.cpp \
     $$PWD/QCSACompletionSet.cpp \
     $$PWD/QCSACompletionModel.cpp \
-    $$PWD/QJsonConvert.cpp
+    $$PWD/QJsonConvert.cpp \
+    $$PWD/QCSANodeCollection.cpp \
+    $$PWD/QCSAPluginManifest.cpp \
+    $$PWD/QCSAWorkerPool.cpp \
+    $$PWD/QCSAScriptWatchdog.cpp
@@ -0,0 +1,177 @@
+#include "QASTNodeIndexTest.hpp"
+#include "QTestHelpers.hpp"
+#include "QASTNode.hpp"
+#include "QSourceLocation.hpp"
+#include "QAnnotatedToken.hpp"
+
+#include <QtTest/QtTest>
+
+using namespace csa;
+using namespace csa::ast;
+
+// Helpers
+// -------
+
+namespace helpers{
+
+class QASTRangeNodeStub : public QASTNode{
+
+public:
+    QASTRangeNodeStub(const QString& identifier, unsigned int start, unsigned int end, QASTNode* parent = 0);
+    QASTRangeNodeStub(const QString& identifier, QASTNode* parent);
+    ~QASTRangeNodeStub();
+};
+
+QASTRangeNodeStub::QASTRangeNodeStub(const QString& identifier, unsigned int start, unsigned int end, QASTNode* parent)
+    : QASTNode(
+          "stub",
+          0,
+          new QSourceLocation("", 0, 0, start),
+          new QSourceLocation("", 0, 0, start),
+          new QSourceLocation("", 0, 0, end),
+          parent)
+{
+    setIdentifier(identifier);
+}
+
+QASTRangeNodeStub::QASTRangeNodeStub(const QString& identifier, QASTNode* parent)
+    : QASTNode("stub", 0, 0, 0, 0, parent)
+{
+    setIdentifier(identifier);
+}
+
+QASTRangeNodeStub::~QASTRangeNodeStub(){
+}
+
+QString identifiers(const QList<QObject*>& nodes){
+    QStringList result;
+    for ( QList<QObject*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it ){
+        QASTNode* node = qobject_cast<QASTNode*>(*it);
+        if ( node )
+            result << node->identifier();
+    }
+    return result.join(",");
+}
+
+} // namespace
+
+using namespace helpers;
+
+// QASTNodeIndexTest Implementation
+// --------------------------------
+
+Q_TEST_RUNNER_REGISTER(QASTNodeIndexTest);
+
+QASTNodeIndexTest::QASTNodeIndexTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+QASTNodeIndexTest::~QASTNodeIndexTest(){
+}
+
+void QASTNodeIndexTest::initTestCase(){
+}
+
+void QASTNodeIndexTest::sortedInsertionTest(){
+    QASTRangeNodeStub root("root", 0, 100);
+    new QASTRangeNodeStub("c", 60, 80, &root);
+    new QASTRangeNodeStub("a", 0, 20, &root);
+    new QASTRangeNodeStub("b", 30, 50, &root);
+
+    QCOMPARE(identifiers(root.children()), QString("a,b,c"));
+}
+
+void QASTNodeIndexTest::cursorPropagationTest(){
+    QASTRangeNodeStub root("root", 0, 100);
+    QASTRangeNodeStub* a = new QASTRangeNodeStub("a", 0, 20, &root);
+    QASTRangeNodeStub* b = new QASTRangeNodeStub("b", 30, 50, &root);
+    QASTRangeNodeStub* b1 = new QASTRangeNodeStub("b1", 35, 40, b);
+    new QASTRangeNodeStub("c", 60, 80, &root);
+
+    QCOMPARE(root.propagateUserCursor(QSourceLocation("", 0, 0, 10)), static_cast<QASTNode*>(a));
+    QCOMPARE(root.propagateUserCursor(QSourceLocation("", 0, 0, 37)), static_cast<QASTNode*>(b1));
+    QCOMPARE(root.propagateUserCursor(QSourceLocation("", 0, 0, 45)), static_cast<QASTNode*>(b));
+    QCOMPARE(root.propagateUserCursor(QSourceLocation("", 0, 0, 55)), static_cast<QASTNode*>(&root));
+    QCOMPARE(root.propagateUserCursor(QSourceLocation("", 0, 0, 120)), static_cast<QASTNode*>(0));
+}
+
+void QASTNodeIndexTest::rangeQueryTest(){
+    QASTRangeNodeStub root("root", 0, 100);
+    new QASTRangeNodeStub("a", 0, 20, &root);
+    QASTRangeNodeStub* b = new QASTRangeNodeStub("b", 30, 50, &root);
+    new QASTRangeNodeStub("b1", 35, 40, b);
+    new QASTRangeNodeStub("b2", 42, 48, b);
+    new QASTRangeNodeStub("c", 60, 80, &root);
+
+    QCOMPARE(identifiers(root.nodesInRange(21, 29)), QString(""));
+    QCOMPARE(identifiers(root.nodesInRange(15, 36)), QString("a,b,b1"));
+    QCOMPARE(identifiers(root.nodesInRange(41, 65)), QString("b,b2,c"));
+    QCOMPARE(identifiers(root.nodesInRange(0, 100)), QString("a,b,b1,b2,c"));
+}
+
+void QASTNodeIndexTest::rangelessChildTest(){
+    QASTRangeNodeStub root("root", 0, 100);
+    QASTRangeNodeStub* a = new QASTRangeNodeStub("a", 0, 20, &root);
+    new QASTRangeNodeStub("c", 60, 80, &root);
+    new QASTRangeNodeStub("x", &root);
+    QASTRangeNodeStub* b = new QASTRangeNodeStub("b", 30, 50, &root);
+    new QASTRangeNodeStub("y", &root);
+
+    QCOMPARE(identifiers(root.children()), QString("x,y,a,b,c"));
+
+    QCOMPARE(root.propagateUserCursor(QSourceLocation("", 0, 0, 0)), static_cast<QASTNode*>(a));
+    QCOMPARE(root.propagateUserCursor(QSourceLocation("", 0, 0, 40)), static_cast<QASTNode*>(b));
+    QCOMPARE(root.propagateUserCursor(QSourceLocation("", 0, 0, 55)), static_cast<QASTNode*>(&root));
+
+    QCOMPARE(identifiers(root.nodesInRange(0, 100)), QString("a,b,c"));
+    QCOMPARE(identifiers(root.nodesInRange(0, 0)), QString("a"));
+}
+
+void QASTNodeIndexTest::overlappingSiblingsTest(){
+    // 'typedef struct s{ ... } t;' declares the struct as a sibling within the range of the typedef
+    QASTRangeNodeStub root("root", 0, 100);
+    QASTRangeNodeStub* t = new QASTRangeNodeStub("t", 0, 40, &root);
+    QASTRangeNodeStub* s = new QASTRangeNodeStub("s", 8, 30, &root);
+    new QASTRangeNodeStub("c", 50, 60, &root);
+
+    QCOMPARE(identifiers(root.children()), QString("t,s,c"));
+
+    QCOMPARE(identifiers(root.nodesInRange(35, 45)), QString("t"));
+    QCOMPARE(identifiers(root.nodesInRange(10, 12)), QString("t,s"));
+    QCOMPARE(identifiers(root.nodesInRange(35, 55)), QString("t,c"));
+
+    QCOMPARE(root.propagateUserCursor(QSourceLocation("", 0, 0, 10)), static_cast<QASTNode*>(s));
+    QCOMPARE(root.propagateUserCursor(QSourceLocation("", 0, 0, 35)), static_cast<QASTNode*>(t));
+    QCOMPARE(root.propagateUserCursor(QSourceLocation("", 0, 0, 45)), static_cast<QASTNode*>(&root));
+}
+
+void QASTNodeIndexTest::tokenLookupTest(){
+    QTestProject project;
+    QVERIFY(project.isValid());
+    QString sourcePath = project.writeFile("source.cpp", "int a;\nint  b;\n");
+    QVERIFY(!sourcePath.isEmpty());
+
+    QSharedPointer<QCodeBase> cbase = createCodeBaseFromFile(sourcePath);
+
+    // Tokens cover their offsets from the first one up to, but excluding, their end
+    QAnnotatedToken* token = cbase->tokenAt(sourcePath, 7);
+    QVERIFY(token != 0);
+    QCOMPARE(token->name(), QString("int"));
+    token = cbase->tokenAt(sourcePath, 9);
+    QVERIFY(token != 0);
+    QCOMPARE(token->name(), QString("int"));
+
+    // Adjacent tokens meet at the start of the second one
+    token = cbase->tokenAt(sourcePath, 5);
+    QVERIFY(token != 0);
+    QCOMPARE(token->name(), QString(";"));
+
+    // Offsets between tokens have none
+    QVERIFY(cbase->tokenAt(sourcePath, 10) == 0);
+    QVERIFY(cbase->tokenAt(sourcePath, 11) == 0);
+
+    token = cbase->tokenAt(sourcePath, 12);
+    QVERIFY(token != 0);
+    QCOMPARE(token->name(), QString("b"));
+}
@@ -0,0 +1,27 @@
+#ifndef QASTNODEINDEXTEST_HPP
+#define QASTNODEINDEXTEST_HPP
+
+#include <QObject>
+#include "QTestRunner.hpp"
+
+class QASTNodeIndexTest : public QObject{
+
+    Q_OBJECT
+    Q_TEST_RUNNER_SUITE
+
+public:
+    explicit QASTNodeIndexTest(QObject *parent = 0);
+    virtual ~QASTNodeIndexTest();
+
+private slots:
+    void initTestCase();
+    void sortedInsertionTest();
+    void cursorPropagationTest();
+    void rangeQueryTest();
+    void rangelessChildTest();
+    void overlappingSiblingsTest();
+    void tokenLookupTest();
+
+};
+
+#endif // QASTNODEINDEXTEST_HPP
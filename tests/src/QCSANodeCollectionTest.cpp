@@ -0,0 +1,214 @@
+#include "QCSANodeCollectionTest.hpp"
+#include "QTestHelpers.hpp"
+
+#include <QJSEngine>
+#include <QtTest/QtTest>
+
+#include "QCodeBase.hpp"
+#include "QCSAPluginLoader.hpp"
+#include "QCSANodeCollection.hpp"
+#include "QASTNode.hpp"
+
+using namespace csa;
+using namespace csa::ast;
+
+// Helpers
+// -------
+
+namespace helpers{
+
+class QASTRangelessNodeStub : public QASTNode{
+
+public:
+    QASTRangelessNodeStub(const QString& identifier);
+};
+
+QASTRangelessNodeStub::QASTRangelessNodeStub(const QString& identifier)
+    : QASTNode("stub", 0, 0, 0, 0, 0)
+{
+    setIdentifier(identifier);
+}
+
+}// namespace helpers
+
+Q_TEST_RUNNER_REGISTER(QCSANodeCollectionTest);
+
+QCSANodeCollectionTest::QCSANodeCollectionTest(QObject *parent)
+    : QObject(parent)
+    , m_project(0)
+    , m_engine(0)
+    , m_pluginLoader(0)
+{
+}
+
+QCSANodeCollectionTest::~QCSANodeCollectionTest(){
+    delete m_pluginLoader;
+    delete m_engine;
+    m_codeBase.clear();
+    delete m_project;
+}
+
+void QCSANodeCollectionTest::initTestCase(){
+    m_project = new helpers::QTestProject;
+    QString sourcePath = m_project->writeFile(
+        "source.cpp",
+        "class A{\n"
+        "public:\n"
+        "    double d;\n"
+        "    float f;\n"
+        "    void run();\n"
+        "};\n"
+        "class B{};\n"
+    );
+    QVERIFY(!sourcePath.isEmpty());
+
+    m_codeBase     = helpers::createCodeBaseFromFile(sourcePath);
+    m_engine       = new QJSEngine;
+    m_pluginLoader = new QCSAPluginLoader(m_engine);
+    m_pluginLoader->setCodeBase(m_codeBase.data());
+    QVERIFY(m_pluginLoader->loadNodeCollection());
+    QVERIFY(m_pluginLoader->loadNodesFunction());
+}
+
+QString QCSANodeCollectionTest::evaluate(const QString& jsCode){
+    QJSValue result;
+    if ( !m_pluginLoader->execute(jsCode, result) )
+        return "error";
+    return result.toString();
+}
+
+void QCSANodeCollectionTest::filterByTypeTest(){
+    QCOMPARE(evaluate("nodes('*', 'class').size()"), QString("2"));
+    QCOMPARE(evaluate("nodes('A', 'class').children().filter('field').size()"), QString("2"));
+    QCOMPARE(evaluate("nodes('A', 'class').children().filter('method').size()"), QString("1"));
+    QCOMPARE(evaluate("nodes('A', 'class').children().filter('class').size()"), QString("0"));
+}
+
+void QCSANodeCollectionTest::filterByPredicateTest(){
+    QCOMPARE(
+        evaluate(
+            "nodes('*', 'class').filter(function(node, index){ return node.identifier() === 'B' && index === 1; })"
+            ".map(function(node){ return node.identifier(); }).join(',')"
+        ),
+        QString("B")
+    );
+
+    // Filters chain natively, and keep the node order
+    QCOMPARE(
+        evaluate(
+            "nodes('A', 'class').children().filter('field').filter(function(node){ return true; })"
+            ".map(function(node){ return node.identifier(); }).join(',')"
+        ),
+        QString("d,f")
+    );
+
+    // A failing predicate stops the filter
+    QCOMPARE(
+        evaluate("nodes('*', 'class').filter(function(node){ throw new Error('stop'); }).size()"),
+        QString("0")
+    );
+}
+
+void QCSANodeCollectionTest::pluckTest(){
+    QCOMPARE(
+        evaluate("JSON.stringify(nodes('*', 'class').pluck(['identifier', 'typeName', 'line']))"),
+        QString("[{\"identifier\":\"A\",\"typeName\":\"class\",\"line\":1},"
+                "{\"identifier\":\"B\",\"typeName\":\"class\",\"line\":7}]")
+    );
+
+    // Other fields are read as node properties
+    QCOMPARE(
+        evaluate("JSON.stringify(nodes('A', 'class').children().filter('field').pluck(['identifier', 'type']))"),
+        QString("[{\"identifier\":\"d\",\"type\":\"double\"},{\"identifier\":\"f\",\"type\":\"float\"}]")
+    );
+
+    QCOMPARE(
+        evaluate("JSON.stringify(table('*', ['identifier'], 'class'))"),
+        QString("[{\"identifier\":\"A\"},{\"identifier\":\"B\"}]")
+    );
+}
+
+void QCSANodeCollectionTest::columnsTest(){
+    QCOMPARE(
+        evaluate("JSON.stringify(nodes('*', 'class').columns(['identifier', 'line']))"),
+        QString("{\"identifier\":[\"A\",\"B\"],\"line\":[1,7]}")
+    );
+    QCOMPARE(evaluate("JSON.stringify(nodes('C', 'class').columns(['identifier']))"), QString("{\"identifier\":[]}"));
+}
+
+void QCSANodeCollectionTest::rangelessFieldsTest(){
+    helpers::QASTRangelessNodeStub node("N");
+    QCSANodeCollection collection(m_engine, m_codeBase.data());
+    collection.append(&node);
+
+    // Nodes without a range only leave their position fields undefined
+    QJSValue row = collection.pluck(QStringList() << "identifier" << "file" << "line" << "endOffset").property(0);
+    QCOMPARE(row.property("identifier").toString(), QString("N"));
+    QVERIFY(row.property("file").isUndefined());
+    QVERIFY(row.property("line").isUndefined());
+    QVERIFY(row.property("endOffset").isUndefined());
+
+    QJSValue columns = collection.columns(QStringList() << "column");
+    QVERIFY(columns.property("column").property(0).isUndefined());
+}
+
+void QCSANodeCollectionTest::visitTest(){
+    QCOMPARE(
+        evaluate(
+            "var visited = []; "
+            "codeBase.files()[0].visit(function(node, depth){ visited.push(node.identifier() + depth); }, "
+            "['class', 'field']); visited.join(',')"
+        ),
+        QString("A1,d2,f2,B1")
+    );
+
+    // Callbacks can skip the children of a node, or end the traversal
+    QCOMPARE(
+        evaluate(
+            "var visited = []; "
+            "codeBase.files()[0].visit(function(node){ visited.push(node.identifier()); return 'skip'; }, "
+            "['class', 'field']); visited.join(',')"
+        ),
+        QString("A,B")
+    );
+    QCOMPARE(
+        evaluate(
+            "var visited = []; "
+            "var completed = codeBase.files()[0].visit(function(node){ "
+            "    visited.push(node.identifier()); "
+            "    return node.identifier() === 'd' ? 'stop' : undefined; "
+            "}, ['class', 'field']); "
+            "visited.join(',') + ':' + completed"
+        ),
+        QString("A,d:false")
+    );
+
+    // Nodes deeper than the maximum depth are not walked
+    QCOMPARE(
+        evaluate(
+            "var visited = []; "
+            "codeBase.files()[0].visit(function(node){ visited.push(node.identifier()); }, [], 1); visited.join(',')"
+        ),
+        QString("A,B")
+    );
+}
+
+void QCSANodeCollectionTest::wrapperIdentityTest(){
+    QCOMPARE(
+        evaluate("codeBase.files()[0].children()[0] === codeBase.files()[0].firstChild()"),
+        QString("true")
+    );
+    QCOMPARE(
+        evaluate(
+            "var first = codeBase.files()[0].children()[0]; var same = false; "
+            "codeBase.files()[0].visit(function(node){ same = node === first; return 'stop'; }); same"
+        ),
+        QString("true")
+    );
+    QCOMPARE(evaluate("nodes('A', 'class').nodes()[0] === codeBase.files()[0].children()[0]"), QString("true"));
+
+    // Wrappers outlive the commands they were returned to
+    QCOMPARE(evaluate("codeBase.files()[0].children()[0].marked = 'yes'"), QString("yes"));
+    m_engine->collectGarbage();
+    QCOMPARE(evaluate("codeBase.files()[0].children()[0].marked"), QString("yes"));
+}
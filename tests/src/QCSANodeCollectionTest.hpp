@@ -0,0 +1,48 @@
+#ifndef QCSANODECOLLECTIONTEST_HPP
+#define QCSANODECOLLECTIONTEST_HPP
+
+#include <QObject>
+#include <QSharedPointer>
+#include "QTestRunner.hpp"
+
+class QJSEngine;
+
+namespace csa{
+class QCodeBase;
+class QCSAPluginLoader;
+}
+
+namespace helpers{
+class QTestProject;
+}
+
+class QCSANodeCollectionTest : public QObject{
+
+    Q_OBJECT
+    Q_TEST_RUNNER_SUITE
+
+public:
+    explicit QCSANodeCollectionTest(QObject *parent = 0);
+    virtual ~QCSANodeCollectionTest();
+
+private slots:
+    void initTestCase();
+    void filterByTypeTest();
+    void filterByPredicateTest();
+    void pluckTest();
+    void columnsTest();
+    void rangelessFieldsTest();
+    void visitTest();
+    void wrapperIdentityTest();
+
+private:
+    QString evaluate(const QString& jsCode);
+
+    helpers::QTestProject*          m_project;
+    QSharedPointer<csa::QCodeBase>  m_codeBase;
+    QJSEngine*                      m_engine;
+    csa::QCSAPluginLoader*          m_pluginLoader;
+
+};
+
+#endif // QCSANODECOLLECTIONTEST_HPP
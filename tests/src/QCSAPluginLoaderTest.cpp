@@ -0,0 +1,316 @@
+#include "QCSAPluginLoaderTest.hpp"
+#include "QTestHelpers.hpp"
+
+#include <QJSEngine>
+#include <QtTest/QtTest>
+
+#include "QCodeBase.hpp"
+#include "QCSAPluginLoader.hpp"
+#include "QCSAPluginManifest.hpp"
+
+using namespace csa;
+
+Q_TEST_RUNNER_REGISTER(QCSAPluginLoaderTest);
+
+QCSAPluginLoaderTest::QCSAPluginLoaderTest(QObject *parent)
+    : QObject(parent)
+    , m_engine(0)
+    , m_pluginLoader(0)
+    , m_project(0)
+{
+}
+
+QCSAPluginLoaderTest::~QCSAPluginLoaderTest(){
+    delete m_pluginLoader;
+    delete m_engine;
+    delete m_project;
+}
+
+void QCSAPluginLoaderTest::initTestCase(){
+    m_engine       = new QJSEngine;
+    m_pluginLoader = new QCSAPluginLoader(m_engine);
+
+    QVERIFY(m_pluginLoader->execute(
+        "function joinArguments(){ \n"
+        "    var values = []; \n"
+        "    for ( var i = 0; i < arguments.length; ++i ) \n"
+        "        values.push(JSON.stringify(arguments[i])); \n"
+        "    return values.join('|'); \n"
+        "}"
+    ));
+}
+
+void QCSAPluginLoaderTest::init(){
+    m_project = new helpers::QTestProject;
+    QVERIFY(m_project->isValid());
+}
+
+void QCSAPluginLoaderTest::cleanup(){
+    delete m_project;
+    m_project = 0;
+}
+
+QString QCSAPluginLoaderTest::evaluate(const QString& jsCode){
+    QJSValue result;
+    if ( !m_pluginLoader->execute(jsCode, result) )
+        return "error";
+    return result.toString();
+}
+
+QStringList QCSAPluginLoaderTest::writeClassSources(const QStringList& classNames){
+    QStringList files;
+    for ( QStringList::const_iterator it = classNames.begin(); it != classNames.end(); ++it )
+        files << m_project->writeFile(it->toLower() + ".cpp", "class " + it->toUtf8() + "{};\n");
+    return files;
+}
+
+// Plugin directory where 'first' calls into another plugin, and 'unused' is never called
+QString QCSAPluginLoaderTest::writePlugins(){
+    if ( !QDir(m_project->path()).mkdir("plugins") )
+        return QString();
+
+    bool written =
+        !m_project->writeFile("plugins/a.js", "function first(){\n    return second();\n}\n").isEmpty() &&
+        !m_project->writeFile("plugins/b.js", "function second(){\n    return 'second';\n}\n").isEmpty() &&
+        !m_project->writeFile("plugins/c.js", "function unused(){\n    return 'unused';\n}\n").isEmpty();
+    return written ? m_project->filePath("plugins") : QString();
+}
+
+void QCSAPluginLoaderTest::loadBatchFunctions(QCSAPluginLoader& loader, QCodeBase* codeBase){
+    loader.setCodeBase(codeBase);
+    QVERIFY(loader.loadNodeCollection());
+    QVERIFY(loader.loadNodesFunction());
+}
+
+void QCSAPluginLoaderTest::plainInvocationTest(){
+    QCOMPARE(evaluate("joinArguments()"), QString(""));
+    QCOMPARE(evaluate("  joinArguments(1) ;  "), QString("1"));
+    QCOMPARE(evaluate("joinArguments(\"a, b)\", 2.5, true)"), QString("\"a, b)\"|2.5|true"));
+    QCOMPARE(
+        evaluate("joinArguments([1, \"x\"], {\"key\": [false]})"),
+        QString("[1,\"x\"]|{\"key\":[false]}")
+    );
+
+    // Undefined functions fail as they would when evaluated
+    QCOMPARE(evaluate("missingFunction(1)"), QString("error"));
+}
+
+void QCSAPluginLoaderTest::evaluatedInvocationTest(){
+    // Commands that are not a single call with json arguments are evaluated
+    QCOMPARE(evaluate("joinArguments('a')"), QString("\"a\""));
+    QCOMPARE(evaluate("joinArguments(1 + 1)"), QString("2"));
+    QCOMPARE(evaluate("joinArguments(1) + joinArguments(2)"), QString("12"));
+    QCOMPARE(evaluate("joinArguments(1), joinArguments(2)"), QString("2"));
+    QCOMPARE(evaluate("joinArguments(joinArguments(3))"), QString("\"3\""));
+}
+
+void QCSAPluginLoaderTest::pluginManifestTest(){
+    QString pluginPath = writePlugins();
+    QVERIFY(!pluginPath.isEmpty());
+
+    QCSAPluginManifest manifest(m_project->filePath("cache"));
+    QVERIFY(manifest.scan(pluginPath));
+    QCOMPARE(manifest.pluginFiles().size(), 3);
+    QCOMPARE(QFileInfo(manifest.pluginFile("first")).fileName(), QString("a.js"));
+    QVERIFY(manifest.pluginFile("missing").isEmpty());
+
+    // Only the plugins exporting names used by the code are required
+    QStringList required = manifest.requiredPluginFiles("first(); first(); var unusedName = 1;");
+    QCOMPARE(required.size(), 1);
+    QCOMPARE(QFileInfo(required[0]).fileName(), QString("a.js"));
+
+    // Scans read back the cached manifest
+    QCSAPluginManifest cachedManifest(m_project->filePath("cache"));
+    QVERIFY(cachedManifest.scan(pluginPath));
+    QCOMPARE(cachedManifest.pluginFile("unused"), manifest.pluginFile("unused"));
+
+    QCOMPARE(
+        QCSAPluginManifest::exportedNames(
+            "function a(){\n    function nested(){}\n}\nNodeCollection.prototype.b = 0;\n"
+        ),
+        QStringList() << "a" << "b"
+    );
+}
+
+void QCSAPluginLoaderTest::lazyPluginTest(){
+    QString pluginPath = writePlugins();
+    QVERIFY(!pluginPath.isEmpty());
+
+    // Keeps the manifest cache out of the user's cache directory
+    QStandardPaths::setTestModeEnabled(true);
+
+    QJSEngine engine;
+    QCSAPluginLoader loader(&engine);
+    QCOMPARE(loader.registerPlugins(pluginPath), 0);
+
+    // Plugins are evaluated once a command uses them, together with the plugins they use
+    QJSValue result;
+    QVERIFY(loader.execute("typeof this['fir' + 'st']", result));
+    QCOMPARE(result.toString(), QString("undefined"));
+
+    QVERIFY(loader.execute("first()", result));
+    QCOMPARE(result.toString(), QString("second"));
+    QVERIFY(loader.execute("typeof this['un' + 'used']", result));
+    QCOMPARE(result.toString(), QString("undefined"));
+
+    QVERIFY(loader.execute("unused()", result));
+    QCOMPARE(result.toString(), QString("unused"));
+
+    QStandardPaths::setTestModeEnabled(false);
+}
+
+void QCSAPluginLoaderTest::batchTest(){
+    QStringList files = writeClassSources(QStringList() << "A" << "B");
+    QVERIFY(!files.contains(QString()));
+
+    QSharedPointer<QCodeBase> cbase = helpers::createCodeBaseFromFile(m_project->path());
+    QJSEngine engine;
+    QCSAPluginLoader loader(&engine);
+    loadBatchFunctions(loader, cbase.data());
+
+    QCOMPARE(loader.executeBatch("file.find('*/', 'class').length", files), 0);
+
+    // Files that were not parsed fail, without stopping the batch
+    QCOMPARE(loader.executeBatch("file.identifier()", QStringList() << files[0] << m_project->filePath("c.cpp")), 1);
+
+    // Edits of every file are written once the batch finishes
+    QCOMPARE(
+        loader.executeBatch("file.insert('class E{};\\n', file.createLocation(0)); codeBase.save();", files),
+        0
+    );
+    QCOMPARE(helpers::readFile(files[0]), QByteArray("class E{};\nclass A{};\n"));
+    QCOMPARE(helpers::readFile(files[1]), QByteArray("class E{};\nclass B{};\n"));
+    QCOMPARE(cbase->find("E/", "class").size(), 2);
+
+    QJSValue result;
+    QVERIFY(loader.execute("typeof file", result));
+    QCOMPARE(result.toString(), QString("undefined"));
+}
+
+void QCSAPluginLoaderTest::parallelBatchTest(){
+    QStringList files = writeClassSources(QStringList() << "A" << "B" << "C");
+    QVERIFY(!files.contains(QString()));
+
+    QSharedPointer<QCodeBase> cbase = helpers::createCodeBaseFromFile(m_project->path());
+    QJSEngine engine;
+    QCSAPluginLoader loader(&engine);
+    loadBatchFunctions(loader, cbase.data());
+    QVERIFY(loader.loadWorkerPool("", 1));
+
+    QCOMPARE(loader.executeBatch("file.find('*/', 'class').length", files, 2), 0);
+
+    // The command is compiled on its own, so it may end with a comment
+    QCOMPARE(loader.executeBatch("path.length > 0 // non empty", files, 2), 0);
+
+    // Workers cannot edit files, so edits are reported as failures instead of being dropped
+    QCOMPARE(
+        loader.executeBatch("file.insert('class E{};\\n', file.createLocation(0))", files, 2),
+        files.size()
+    );
+    QCOMPARE(helpers::readFile(files[0]), QByteArray("class A{};\n"));
+    QCOMPARE(cbase->find("E/", "class").size(), 0);
+}
+
+void QCSAPluginLoaderTest::workerPoolTest(){
+    QStringList files = writeClassSources(QStringList() << "A" << "B");
+    QVERIFY(!files.contains(QString()));
+
+    QSharedPointer<QCodeBase> cbase = helpers::createCodeBaseFromFile(m_project->path());
+    QJSEngine engine;
+    QCSAPluginLoader loader(&engine);
+    loadBatchFunctions(loader, cbase.data());
+    QVERIFY(loader.loadWorkerPool("", 2));
+
+    // Results keep the order of the files, and workers can read the whole code base
+    QJSValue result;
+    QVERIFY(loader.execute(
+        "var files = codeBase.files(); \n"
+        "parallelMap(files, function(file, path){ \n"
+        "    return file.find('*/', 'class')[0].identifier() + ':' + (file.identifier() === path); \n"
+        "}).join(',') === \n"
+        "files.map(function(file){ return file.find('*/', 'class')[0].identifier() + ':true'; }).join(',')",
+        result
+    ));
+    QCOMPARE(result.toString(), QString("true"));
+
+    QVERIFY(loader.execute(
+        "parallelMap(codeBase.files(), function(file){ return codeBase.files().length; }).join(',')", result
+    ));
+    QCOMPARE(result.toString(), QString("2,2"));
+
+    // Edits and saves from workers are rejected, and leave no result
+    QVERIFY(loader.execute(
+        "parallelMap(codeBase.files(), function(file){ \n"
+        "    file.insert('class E{};\\n', file.createLocation(0)); \n"
+        "    return 'edited'; \n"
+        "}).join(',')",
+        result
+    ));
+    QCOMPARE(result.toString(), QString(","));
+
+    QVERIFY(loader.execute(
+        "parallelMap(codeBase.files(), function(file){ codeBase.save(); return 'saved'; }).join(',')", result
+    ));
+    QCOMPARE(result.toString(), QString(","));
+
+    ast::QASTFile* file = cbase->findFile(files[0]);
+    QVERIFY(file != 0);
+    QVERIFY(!file->hasModifiers());
+    QCOMPARE(helpers::readFile(files[0]), QByteArray("class A{};\n"));
+
+    // Mapped values other than functions are refused before reaching the workers
+    QVERIFY(!loader.execute("parallelMap(codeBase.files(), 'file')", result));
+}
+
+void QCSAPluginLoaderTest::timeBudgetTest(){
+#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
+    QSKIP("Commands can only be interrupted from Qt 5.14.");
+#endif
+    QJSEngine engine;
+    QCSAPluginLoader loader(&engine);
+    loader.setTimeBudget(200);
+
+    // Commands running past the budget fail, and the engine is ready for the next command
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY(!loader.execute("while ( true ){}"));
+    QVERIFY(timer.elapsed() < 10000);
+
+    QJSValue result;
+    QVERIFY(loader.execute("1 + 1", result));
+    QCOMPARE(result.toInt(), 2);
+
+    // So are plain function invocations
+    QVERIFY(loader.execute("function spin(){ while ( true ){} }\nfunction add(a, b){ return a + b; }"));
+    QVERIFY(!loader.execute("spin()"));
+    QVERIFY(loader.execute("add(1, 2)", result));
+    QCOMPARE(result.toInt(), 3);
+}
+
+void QCSAPluginLoaderTest::interruptedBatchTest(){
+#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
+    QSKIP("Commands can only be interrupted from Qt 5.14.");
+#endif
+    QStringList files = writeClassSources(QStringList() << "A" << "B");
+    QVERIFY(!files.contains(QString()));
+
+    QSharedPointer<QCodeBase> cbase = helpers::createCodeBaseFromFile(m_project->path());
+    QJSEngine engine;
+    QCSAPluginLoader loader(&engine);
+    loadBatchFunctions(loader, cbase.data());
+    loader.setTimeBudget(200);
+
+    // The command for the second file never finishes, and only its own edit is discarded
+    QCOMPARE(
+        loader.executeBatch(
+            "file.insert('class E{};\\n', file.createLocation(0)); "
+            "while ( /\\/b\\.cpp$/.test(file.identifier()) ){} "
+            "codeBase.save();",
+            files
+        ),
+        1
+    );
+    QCOMPARE(helpers::readFile(files[0]), QByteArray("class E{};\nclass A{};\n"));
+    QCOMPARE(helpers::readFile(files[1]), QByteArray("class B{};\n"));
+    QCOMPARE(cbase->find("E/", "class").size(), 1);
+}
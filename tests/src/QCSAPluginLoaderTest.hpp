@@ -0,0 +1,53 @@
+#ifndef QCSAPLUGINLOADERTEST_HPP
+#define QCSAPLUGINLOADERTEST_HPP
+
+#include <QObject>
+#include "QTestRunner.hpp"
+
+class QJSEngine;
+
+namespace csa{
+class QCodeBase;
+class QCSAPluginLoader;
+}
+
+namespace helpers{
+class QTestProject;
+}
+
+class QCSAPluginLoaderTest : public QObject{
+
+    Q_OBJECT
+    Q_TEST_RUNNER_SUITE
+
+public:
+    explicit QCSAPluginLoaderTest(QObject *parent = 0);
+    virtual ~QCSAPluginLoaderTest();
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void plainInvocationTest();
+    void evaluatedInvocationTest();
+    void pluginManifestTest();
+    void lazyPluginTest();
+    void batchTest();
+    void parallelBatchTest();
+    void workerPoolTest();
+    void timeBudgetTest();
+    void interruptedBatchTest();
+
+private:
+    QString evaluate(const QString& jsCode);
+    QStringList writeClassSources(const QStringList& classNames);
+    QString writePlugins();
+    void loadBatchFunctions(csa::QCSAPluginLoader& loader, csa::QCodeBase* codeBase);
+
+    QJSEngine*             m_engine;
+    csa::QCSAPluginLoader* m_pluginLoader;
+    helpers::QTestProject* m_project;
+
+};
+
+#endif // QCSAPLUGINLOADERTEST_HPP
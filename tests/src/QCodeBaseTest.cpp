@@ -0,0 +1,364 @@
+#include "QCodeBaseTest.hpp"
+#include "QTestHelpers.hpp"
+
+#include <QtTest/QtTest>
+#include <QSignalSpy>
+#include <QBuffer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include "QCodeBase.hpp"
+#include "QASTFile.hpp"
+#include "QSourceLocation.hpp"
+#include "QAnnotatedTokenSet.hpp"
+
+using namespace csa;
+using namespace csa::ast;
+
+Q_TEST_RUNNER_REGISTER(QCodeBaseTest);
+
+QCodeBaseTest::QCodeBaseTest(QObject *parent)
+    : QObject(parent)
+    , m_project(0)
+{
+}
+
+QCodeBaseTest::~QCodeBaseTest(){
+    delete m_project;
+}
+
+void QCodeBaseTest::initTestCase(){
+    qRegisterMetaType<csa::ast::QASTFile*>();
+}
+
+void QCodeBaseTest::init(){
+    m_project = new helpers::QTestProject;
+    QVERIFY(m_project->isValid());
+}
+
+void QCodeBaseTest::cleanup(){
+    delete m_project;
+    m_project = 0;
+}
+
+void QCodeBaseTest::sharedContentTest(){
+    QByteArray source("// \xc3\xa9\nclass A{};\n");
+    QString sourcePath = m_project->writeFile("source.cpp", source);
+    QVERIFY(!sourcePath.isEmpty());
+
+    QSharedPointer<QCodeBase> cbase = helpers::createCodeBaseFromFile(sourcePath);
+    QASTFile* file = cbase->findFile(sourcePath);
+    QVERIFY(file != 0);
+    QCOMPARE(file->content(), source);
+
+    // Reads take byte offsets into the loaded buffer
+    QCOMPARE(file->read(file->createLocation(0), file->createLocation(6)), QString::fromUtf8("// \xc3\xa9\n"));
+
+    QList<QObject*> found = cbase->find("A/", "class");
+    QCOMPARE(found.size(), 1);
+    QASTNode* node = qobject_cast<QASTNode*>(found[0]);
+    QVERIFY(node != 0);
+    QVERIFY(node->text().startsWith("class A{"));
+
+    // Pending edits outside a node leave its text unchanged
+    QVERIFY(file->insert("class B{};\n", file->createLocation(0)));
+    QVERIFY(node->text().startsWith("class A{"));
+    QCOMPARE(file->content(), source);
+}
+
+void QCodeBaseTest::pendingEditMappingTest(){
+    QString sourcePath = m_project->writeFile("source.cpp", "class A{};\nclass B{};\n");
+    QVERIFY(!sourcePath.isEmpty());
+
+    QSharedPointer<QCodeBase> cbase = helpers::createCodeBaseFromFile(sourcePath);
+    QASTFile* file = cbase->findFile(sourcePath);
+    QVERIFY(file != 0);
+
+    QList<QObject*> found = cbase->find("B/", "class");
+    QCOMPARE(found.size(), 1);
+    QASTNode* node = qobject_cast<QASTNode*>(found[0]);
+    QVERIFY(node != 0);
+    QCOMPARE(node->rangeStartLocation()->offset(), 11u);
+
+    // Interleaved inserts and erasures are mapped without reparsing
+    QVERIFY(file->insert("// c\n", file->createLocation(0)));
+    QVERIFY(file->erase(file->createLocation(6), file->createLocation(7)));
+    QVERIFY(file->insert("Z", file->createLocation(6)));
+    QCOMPARE(file->readAll(), QString("// c\nclass Z{};\nclass B{};\n"));
+
+    QCOMPARE(file->modifiedOffset(node->rangeStartLocation()), 16u);
+    QCOMPARE(file->createModifiedLocation(16)->offset(), 11u);
+
+    // Nodes parsed before the edits still locate their insertions
+    QVERIFY(file->insert("class S{};\n", node->rangeStartLocation()));
+    cbase->save();
+    QCOMPARE(helpers::readFile(sourcePath), QByteArray("// c\nclass Z{};\nclass S{};\nclass B{};\n"));
+    QCOMPARE(cbase->find("Z/", "class").size(), 1);
+    QCOMPARE(cbase->find("S/", "class").size(), 1);
+}
+
+void QCodeBaseTest::deferredSaveTest(){
+    QString sourcePath = m_project->writeFile("source.cpp", "class A{};\n");
+    QVERIFY(!sourcePath.isEmpty());
+
+    QSharedPointer<QCodeBase> cbase = helpers::createCodeBaseFromFile(sourcePath);
+    cbase->setDeferredSave(true);
+
+    QASTFile* file = cbase->findFile(sourcePath);
+    QVERIFY(file != 0);
+    QVERIFY(file->insert("class B{};\n", file->createLocation(0)));
+
+    // Saving is postponed until the tree is queried
+    cbase->save();
+    QCOMPARE(helpers::readFile(sourcePath), QByteArray("class A{};\n"));
+
+    QCOMPARE(cbase->find("B/", "class").size(), 1);
+    QCOMPARE(helpers::readFile(sourcePath), QByteArray("class B{};\nclass A{};\n"));
+}
+
+void QCodeBaseTest::coalescedSaveTest(){
+    QString sourcePath = m_project->writeFile("source.cpp", "class A{};\n");
+    QVERIFY(!sourcePath.isEmpty());
+
+    QSharedPointer<QCodeBase> cbase = helpers::createCodeBaseFromFile(sourcePath);
+    cbase->setDeferredSave(true);
+    QSignalSpy reparseSpy(cbase.data(), SIGNAL(fileReparsed(csa::ast::QASTFile*)));
+
+    QASTFile* file = cbase->findFile(sourcePath);
+    QVERIFY(file != 0);
+    QVERIFY(file->insert("class B{};\n", file->createLocation(0)));
+    cbase->save();
+    QVERIFY(file->insert("class C{};\n", file->createLocation(0)));
+    cbase->save();
+    QCOMPARE(reparseSpy.count(), 0);
+
+    // Edits saved several times before a query are written and reparsed once
+    QCOMPARE(cbase->find("B/", "class").size(), 1);
+    QCOMPARE(cbase->find("C/", "class").size(), 1);
+    QCOMPARE(reparseSpy.count(), 1);
+    QCOMPARE(helpers::readFile(sourcePath), QByteArray("class B{};\nclass C{};\nclass A{};\n"));
+}
+
+void QCodeBaseTest::heldSaveTest(){
+    QString sourcePath = m_project->writeFile("source.cpp", "class A{};\n");
+    QVERIFY(!sourcePath.isEmpty());
+
+    QSharedPointer<QCodeBase> cbase = helpers::createCodeBaseFromFile(sourcePath);
+    cbase->setSaveHeld(true);
+
+    QASTFile* file = cbase->findFile(sourcePath);
+    QVERIFY(file != 0);
+    QVERIFY(file->insert("class B{};\n", file->createLocation(0)));
+
+    // Held saves are kept even when the tree is queried
+    cbase->save();
+    QCOMPARE(cbase->find("B/", "class").size(), 0);
+    QCOMPARE(helpers::readFile(sourcePath), QByteArray("class A{};\n"));
+
+    cbase->setSaveHeld(false);
+    QCOMPARE(helpers::readFile(sourcePath), QByteArray("class B{};\nclass A{};\n"));
+    QCOMPARE(cbase->find("B/", "class").size(), 1);
+}
+
+void QCodeBaseTest::byteExactSaveTest(){
+    QString sourcePath = m_project->writeFile("source.cpp", "// \xe9\r\nclass A{};\r\n");
+    QVERIFY(!sourcePath.isEmpty());
+
+    QSharedPointer<QCodeBase> cbase = helpers::createCodeBaseFromFile(sourcePath);
+    QASTFile* file = cbase->findFile(sourcePath);
+    QVERIFY(file != 0);
+    QVERIFY(file->insert("class B{};\r\n", file->createLocation(6)));
+    cbase->save();
+
+    // Bytes outside the edits are kept as they were, and the file is replaced without leftovers
+    QCOMPARE(helpers::readFile(sourcePath), QByteArray("// \xe9\r\nclass B{};\r\nclass A{};\r\n"));
+    QCOMPARE(QDir(m_project->path()).entryList(QDir::Files), QStringList() << "source.cpp");
+    QCOMPARE(cbase->find("B/", "class").size(), 1);
+}
+
+void QCodeBaseTest::editOutputTest(){
+    QString sourcePath = m_project->writeFile("source.cpp", "class A{};\n");
+    QVERIFY(!sourcePath.isEmpty());
+
+    QSharedPointer<QCodeBase> cbase = helpers::createCodeBaseFromFile(sourcePath);
+
+    QBuffer output;
+    output.open(QIODevice::WriteOnly);
+    cbase->setEditOutput(&output);
+
+    QASTFile* file = cbase->findFile(sourcePath);
+    QVERIFY(file != 0);
+    QVERIFY(file->insert("class B{};\n", file->createLocation(0)));
+    cbase->save();
+
+    // Edits are written as a json line per file, while the file on disk stays unchanged
+    QVERIFY(output.data().endsWith('\n'));
+    QJsonObject patch = QJsonDocument::fromJson(output.data()).object();
+    QCOMPARE(patch["file"].toString(), sourcePath);
+
+    QJsonArray edits = patch["edits"].toArray();
+    QCOMPARE(edits.size(), 1);
+    QCOMPARE(edits[0].toObject()["from"].toInt(), 0);
+    QCOMPARE(edits[0].toObject()["to"].toInt(), 0);
+    QCOMPARE(edits[0].toObject()["text"].toString(), QString("class B{};\n"));
+
+    QCOMPARE(helpers::readFile(sourcePath), QByteArray("class A{};\n"));
+
+    // The tree is rebuilt from the edited content
+    QCOMPARE(cbase->find("B/", "class").size(), 1);
+    QCOMPARE(file->readAll(), QString("class B{};\nclass A{};\n"));
+}
+
+void QCodeBaseTest::unsavedContentTest(){
+    QString sourcePath = m_project->writeFile("source.cpp", "class A{};\n");
+    QVERIFY(!sourcePath.isEmpty());
+
+    // Buffers given before parsing replace the file contents
+    const char* args[] = {"-c", "-x", "c++"};
+    QHash<QString, QByteArray> unsavedContents;
+    unsavedContents[sourcePath] = "class B{};\n";
+    QCodeBase cbase(args, 3, QStringList() << sourcePath, unsavedContents);
+
+    QCOMPARE(cbase.find("A/", "class").size(), 0);
+    QCOMPARE(cbase.find("B/", "class").size(), 1);
+
+    // Buffers of parsed files are reparsed right away
+    cbase.setUnsavedContent(sourcePath, "class C{};\nclass D{};\n");
+    QCOMPARE(cbase.find("B/", "class").size(), 0);
+    QCOMPARE(cbase.find("C/", "class").size(), 1);
+    QCOMPARE(cbase.find("D/", "class").size(), 1);
+
+    QCOMPARE(helpers::readFile(sourcePath), QByteArray("class A{};\n"));
+}
+
+void QCodeBaseTest::unsavedHeaderReparseTest(){
+    QString headerPath = m_project->writeFile("header.hpp", "#define NAME Disk\n");
+    QString sourcePath = m_project->writeFile("source.cpp", "#include \"header.hpp\"\nclass NAME{};\n");
+    QVERIFY(!headerPath.isEmpty() && !sourcePath.isEmpty());
+
+    const char* args[] = {"-c", "-x", "c++"};
+    QHash<QString, QByteArray> unsavedContents;
+    unsavedContents[headerPath] = "#define NAME Unsaved\n";
+    QCodeBase cbase(args, 3, QStringList() << sourcePath, unsavedContents);
+    QCOMPARE(cbase.find("Unsaved/", "class").size(), 1);
+
+    // Buffers of files that are not parsed themselves are kept when the files including them are reparsed
+    QASTFile* file = cbase.findFile(sourcePath);
+    QVERIFY(file != 0);
+    QVERIFY(file->insert("class S{};\n", file->createLocation(0)));
+    cbase.save();
+
+    QCOMPARE(cbase.find("S/", "class").size(), 1);
+    QCOMPARE(cbase.find("Unsaved/", "class").size(), 1);
+    QCOMPARE(cbase.find("Disk/", "class").size(), 0);
+}
+
+void QCodeBaseTest::unsavedInputFramingTest(){
+    QBuffer input;
+    input.setData("class A{};\nclass B{};\nclass C{};\n");
+    input.open(QIODevice::ReadOnly);
+
+    // Sized contents are read in order, and the last file may take the rest of the input
+    QHash<QString, QByteArray> contents;
+    QVERIFY(QCodeBase::readUnsavedContents(
+        &input, QStringList() << "a.cpp" << "b.cpp" << "c.cpp", QList<int>() << 11 << 0 << -1, contents
+    ));
+    QCOMPARE(contents.size(), 3);
+    QCOMPARE(contents["a.cpp"], QByteArray("class A{};\n"));
+    QCOMPARE(contents["b.cpp"], QByteArray(""));
+    QCOMPARE(contents["c.cpp"], QByteArray("class B{};\nclass C{};\n"));
+
+    // Input ending before a sized file is complete is rejected
+    QBuffer shortInput;
+    shortInput.setData("class A{};\n");
+    shortInput.open(QIODevice::ReadOnly);
+
+    QHash<QString, QByteArray> shortContents;
+    QVERIFY(!QCodeBase::readUnsavedContents(&shortInput, QStringList() << "a.cpp", QList<int>() << 12, shortContents));
+}
+
+void QCodeBaseTest::staleFileReparseTest(){
+    QString headerPath = m_project->writeFile("header.hpp", "class H{};\n");
+    QString sourcePath = m_project->writeFile("source.cpp", "#include \"header.hpp\"\nclass S{};\n");
+    QVERIFY(!headerPath.isEmpty() && !sourcePath.isEmpty());
+
+    QSharedPointer<QCodeBase> cbase = helpers::createCodeBaseFromFile(sourcePath);
+    QCOMPARE(cbase->reparseStaleFiles(), 0);
+
+    // Files changed on disk are reparsed once
+    QVERIFY(helpers::writeFile(sourcePath, "#include \"header.hpp\"\nclass S{};\nclass T{};\n"));
+    QCOMPARE(cbase->reparseStaleFiles(), 1);
+    QCOMPARE(cbase->find("T/", "class").size(), 1);
+    QCOMPARE(cbase->reparseStaleFiles(), 0);
+
+    // So are files including a changed file
+    QVERIFY(helpers::writeFile(headerPath, "class H{};\nclass I{};\n"));
+    QCOMPARE(cbase->reparseStaleFiles(), 1);
+    QCOMPARE(cbase->reparseStaleFiles(), 0);
+}
+
+void QCodeBaseTest::dependentReparseTest(){
+    QString headerPath    = m_project->writeFile("header.hpp", "#define NAME A\n");
+    QString includingPath = m_project->writeFile("including.cpp", "#include \"header.hpp\"\nclass NAME{};\n");
+    QString unrelatedPath = m_project->writeFile("unrelated.cpp", "class U{};\n");
+    QVERIFY(!headerPath.isEmpty() && !includingPath.isEmpty() && !unrelatedPath.isEmpty());
+
+    const char* args[] = {"-c", "-x", "c++"};
+    QCodeBase cbase(args, 3, QStringList() << headerPath << includingPath << unrelatedPath);
+    QCOMPARE(cbase.find("A/", "class").size(), 1);
+
+    QSignalSpy reparseSpy(&cbase, SIGNAL(fileReparsed(csa::ast::QASTFile*)));
+
+    QASTFile* header = cbase.findFile(headerPath);
+    QVERIFY(header != 0);
+    QVERIFY(header->erase(header->createLocation(13), header->createLocation(14)));
+    QVERIFY(header->insert("B", header->createLocation(13)));
+    cbase.save();
+
+    // Saving a header reparses the files including it, and only those
+    QStringList reparsedFiles;
+    for ( int i = 0; i < reparseSpy.count(); ++i )
+        reparsedFiles.append(reparseSpy.at(i).at(0).value<csa::ast::QASTFile*>()->fileName());
+    reparsedFiles.sort();
+    QCOMPARE(reparsedFiles, QStringList() << "header.hpp" << "including.cpp");
+
+    QCOMPARE(cbase.find("A/", "class").size(), 0);
+    QCOMPARE(cbase.find("B/", "class").size(), 1);
+}
+
+void QCodeBaseTest::sharedTranslationUnitTest(){
+    QString headerPath = m_project->writeFile("header.hpp", "class H{};\n");
+    QString sourcePath = m_project->writeFile("source.cpp", "#include \"header.hpp\"\nclass S{};\n");
+    QString loosePath  = m_project->writeFile("loose.hpp", "class L{};\n");
+    QVERIFY(!headerPath.isEmpty() && !sourcePath.isEmpty() && !loosePath.isEmpty());
+
+    const char* args[] = {"-c", "-x", "c++"};
+    QCodeBase cbase(
+        args, 3,
+        QStringList() << m_project->path(),
+        QHash<QString, QByteArray>(),
+        QCodeBase::SharedTranslationUnits,
+        QStringList(),
+        m_project->path()
+    );
+    QCOMPARE(cbase.astFiles().size(), 3);
+
+    QHash<QString, QASTFile*> files;
+    for ( QList<QASTFile*>::const_iterator it = cbase.astFiles().begin(); it != cbase.astFiles().end(); ++it )
+        files[(*it)->fileName()] = *it;
+
+    QASTFile* header = files.value("header.hpp");
+    QASTFile* source = files.value("source.cpp");
+    QASTFile* loose  = files.value("loose.hpp");
+    QVERIFY(header != 0 && source != 0 && loose != 0);
+
+    // Included headers get their trees from the source's translation unit, the others are parsed on their own
+    QVERIFY(header->tokenSet()->translationUnit() == source->tokenSet()->translationUnit());
+    QVERIFY(loose->tokenSet()->translationUnit() != source->tokenSet()->translationUnit());
+    QCOMPARE(cbase.parseFile(header->identifier()), header);
+
+    QCOMPARE(cbase.find("H/", "class").size(), 1);
+    QCOMPARE(cbase.find("S/", "class").size(), 1);
+    QCOMPARE(cbase.find("L/", "class").size(), 1);
+}
@@ -0,0 +1,43 @@
+#ifndef QCODEBASETEST_HPP
+#define QCODEBASETEST_HPP
+
+#include <QObject>
+#include "QTestRunner.hpp"
+
+namespace helpers{
+class QTestProject;
+}
+
+class QCodeBaseTest : public QObject{
+
+    Q_OBJECT
+    Q_TEST_RUNNER_SUITE
+
+public:
+    explicit QCodeBaseTest(QObject *parent = 0);
+    virtual ~QCodeBaseTest();
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void sharedContentTest();
+    void pendingEditMappingTest();
+    void deferredSaveTest();
+    void coalescedSaveTest();
+    void heldSaveTest();
+    void byteExactSaveTest();
+    void editOutputTest();
+    void unsavedContentTest();
+    void unsavedHeaderReparseTest();
+    void unsavedInputFramingTest();
+    void staleFileReparseTest();
+    void dependentReparseTest();
+    void sharedTranslationUnitTest();
+
+private:
+    helpers::QTestProject* m_project;
+
+};
+
+#endif // QCODEBASETEST_HPP
@@ -0,0 +1,129 @@
+#include "QPieceTableTest.hpp"
+#include "QPieceTable.hpp"
+
+#include <QtTest/QtTest>
+#include <QBuffer>
+
+using namespace csa;
+
+Q_TEST_RUNNER_REGISTER(QPieceTableTest);
+
+QPieceTableTest::QPieceTableTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+QPieceTableTest::~QPieceTableTest(){
+}
+
+void QPieceTableTest::initTestCase(){
+}
+
+void QPieceTableTest::insertionTest(){
+    QPieceTable table("0123456789");
+    QCOMPARE(table.isModified(), false);
+
+    table.insert(3, "a");
+    table.insert(10, "E");
+    table.insert(3, "b");
+    table.insert(0, "S");
+
+    QCOMPARE(table.isModified(), true);
+    QCOMPARE(table.totalInsertions(), 4);
+    QCOMPARE(table.readAll(), QByteArray("S012ab3456789E"));
+}
+
+void QPieceTableTest::erasureTest(){
+    QPieceTable table("0123456789");
+    table.insert(3, "a");
+    table.erase(2, 6);
+    QCOMPARE(table.readAll(), QByteArray("01a6789"));
+
+    table.erase(7, 8);
+    table.erase(5, 9);
+    QCOMPARE(table.readAll(), QByteArray("01a9"));
+    QCOMPARE(table.totalErasures(), 3);
+
+    table.reset("abc");
+    QCOMPARE(table.isModified(), false);
+    QCOMPARE(table.readAll(), QByteArray("abc"));
+}
+
+void QPieceTableTest::rangeReadTest(){
+    QPieceTable table("0123456789");
+    table.insert(0, "S");
+    table.insert(3, "ab");
+    table.erase(4, 6);
+
+    QCOMPARE(table.read(1, 7), QByteArray("12ab36"));
+    QCOMPARE(table.read(0, 2), QByteArray("S01"));
+    QCOMPARE(table.read(4, 6), QByteArray(""));
+}
+
+void QPieceTableTest::writeTest(){
+    QPieceTable table("class A{\n};\n");
+    table.insert(9, "    int m_a;\n");
+    table.insert(0, "namespace n{\n");
+    table.insert(12, "}\n");
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QCOMPARE(table.write(&buffer), true);
+    QCOMPARE(buffer.data(), QByteArray("namespace n{\nclass A{\n    int m_a;\n};\n}\n"));
+}
+
+void QPieceTableTest::offsetMappingTest(){
+    QPieceTable table("0123456789");
+    QCOMPARE(table.modifiedOffset(4), 4u);
+
+    table.insert(3, "ab");
+    table.insert(0, "S");
+    table.erase(5, 7);
+    table.insert(6, "X");
+    QCOMPARE(table.readAll(), QByteArray("S012ab34X789"));
+    QCOMPARE(table.modifiedSize(), 12u);
+
+    QCOMPARE(table.modifiedOffset(0), 1u);
+    QCOMPARE(table.modifiedOffset(3), 6u);
+    QCOMPARE(table.modifiedOffset(6), 9u);
+    QCOMPARE(table.modifiedOffset(7), 9u);
+    QCOMPARE(table.modifiedOffset(10), 12u);
+
+    QCOMPARE(table.originalOffset(0), 0u);
+    QCOMPARE(table.originalOffset(4), 3u);
+    QCOMPARE(table.originalOffset(6), 3u);
+    QCOMPARE(table.originalOffset(8), 6u);
+    QCOMPARE(table.originalOffset(9), 7u);
+    QCOMPARE(table.originalOffset(12), 10u);
+}
+
+void QPieceTableTest::editListTest(){
+    QPieceTable table("0123456789");
+    QCOMPARE(table.edits().size(), static_cast<size_t>(0));
+
+    table.insert(3, "ab");
+    table.insert(0, "S");
+    table.erase(5, 7);
+    table.insert(6, "X");
+    table.erase(9, 10);
+    table.insert(10, "E");
+
+    QPieceTable::EditList edits = table.edits();
+    QCOMPARE(edits.size(), static_cast<size_t>(4));
+
+    QCOMPARE(edits[0].from, 0u);
+    QCOMPARE(edits[0].to, 0u);
+    QCOMPARE(edits[0].replacement, QByteArray("S"));
+
+    QCOMPARE(edits[1].from, 3u);
+    QCOMPARE(edits[1].to, 3u);
+    QCOMPARE(edits[1].replacement, QByteArray("ab"));
+
+    QCOMPARE(edits[2].from, 5u);
+    QCOMPARE(edits[2].to, 7u);
+    QCOMPARE(edits[2].replacement, QByteArray("X"));
+
+    QCOMPARE(edits[3].from, 9u);
+    QCOMPARE(edits[3].to, 10u);
+    QCOMPARE(edits[3].replacement, QByteArray("E"));
+}
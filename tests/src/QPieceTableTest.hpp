@@ -0,0 +1,27 @@
+#ifndef QPIECETABLETEST_HPP
+#define QPIECETABLETEST_HPP
+
+#include <QObject>
+#include "QTestRunner.hpp"
+
+class QPieceTableTest : public QObject{
+
+    Q_OBJECT
+    Q_TEST_RUNNER_SUITE
+
+public:
+    explicit QPieceTableTest(QObject *parent = 0);
+    virtual ~QPieceTableTest();
+
+private slots:
+    void initTestCase();
+    void insertionTest();
+    void erasureTest();
+    void rangeReadTest();
+    void writeTest();
+    void offsetMappingTest();
+    void editListTest();
+
+};
+
+#endif // QPIECETABLETEST_HPP
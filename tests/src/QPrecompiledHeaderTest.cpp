@@ -0,0 +1,89 @@
+#include "QPrecompiledHeaderTest.hpp"
+#include "QTestHelpers.hpp"
+#include "QPrecompiledHeader.hpp"
+
+#include <QtTest/QtTest>
+
+using namespace csa;
+
+Q_TEST_RUNNER_REGISTER(QPrecompiledHeaderTest);
+
+QPrecompiledHeaderTest::QPrecompiledHeaderTest(QObject *parent)
+    : QObject(parent)
+    , m_project(0)
+{
+}
+
+QPrecompiledHeaderTest::~QPrecompiledHeaderTest(){
+    delete m_project;
+}
+
+void QPrecompiledHeaderTest::initTestCase(){
+}
+
+void QPrecompiledHeaderTest::init(){
+    m_project = new helpers::QTestProject;
+    QVERIFY(m_project->isValid());
+}
+
+void QPrecompiledHeaderTest::cleanup(){
+    delete m_project;
+    m_project = 0;
+}
+
+void QPrecompiledHeaderTest::reuseTest(){
+    QVERIFY(!m_project->writeFile("common.hpp", "class C{};\n").isEmpty());
+
+    const char* args[] = {"-c", "-x", "c++"};
+    CXIndex index = clang_createIndex(0, 0);
+
+    QPrecompiledHeader pch(QStringList() << "common.hpp", m_project->path(), m_project->filePath("cache"));
+    QVERIFY(pch.path().isEmpty());
+    QVERIFY(pch.update(index, args, 3));
+    QVERIFY(QFileInfo(pch.path()).exists());
+
+    QString pchPath = pch.path();
+    QDateTime pchBuilt = QFileInfo(pchPath).lastModified();
+
+    // An up to date header is kept, and found again by other instances with the same arguments
+    QVERIFY(pch.update(index, args, 3));
+    QCOMPARE(pch.path(), pchPath);
+
+    QPrecompiledHeader cachedPch(QStringList() << "common.hpp", m_project->path(), m_project->filePath("cache"));
+    QVERIFY(cachedPch.update(index, args, 3));
+    QCOMPARE(cachedPch.path(), pchPath);
+    QCOMPARE(QFileInfo(pchPath).lastModified(), pchBuilt);
+
+    // Different arguments use a header of their own
+    const char* otherArgs[] = {"-c", "-x", "c++", "-DOTHER"};
+    QPrecompiledHeader otherPch(QStringList() << "common.hpp", m_project->path(), m_project->filePath("cache"));
+    QVERIFY(otherPch.update(index, otherArgs, 4));
+    QVERIFY(otherPch.path() != pchPath);
+
+    clang_disposeIndex(index);
+}
+
+void QPrecompiledHeaderTest::invalidationTest(){
+    QString headerPath = m_project->writeFile("common.hpp", "class C{};\n");
+    QVERIFY(!headerPath.isEmpty());
+
+    const char* args[] = {"-c", "-x", "c++"};
+    CXIndex index = clang_createIndex(0, 0);
+
+    QPrecompiledHeader pch(QStringList() << "common.hpp", m_project->path(), m_project->filePath("cache"));
+    QVERIFY(pch.update(index, args, 3));
+    QVERIFY(pch.isValid());
+    QVERIFY(!pch.hasUserHeadersChanged());
+
+    // Changing a header it was built from invalidates it until the next update rebuilds it
+    QVERIFY(helpers::writeFile(headerPath, "class C{};\nclass D{};\n"));
+    QVERIFY(!pch.isValid());
+    QVERIFY(pch.hasUserHeadersChanged());
+
+    QVERIFY(pch.update(index, args, 3));
+    QVERIFY(pch.isValid());
+    QVERIFY(!pch.hasUserHeadersChanged());
+    QVERIFY(QFileInfo(pch.path()).exists());
+
+    clang_disposeIndex(index);
+}
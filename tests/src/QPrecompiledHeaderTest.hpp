@@ -0,0 +1,32 @@
+#ifndef QPRECOMPILEDHEADERTEST_HPP
+#define QPRECOMPILEDHEADERTEST_HPP
+
+#include <QObject>
+#include "QTestRunner.hpp"
+
+namespace helpers{
+class QTestProject;
+}
+
+class QPrecompiledHeaderTest : public QObject{
+
+    Q_OBJECT
+    Q_TEST_RUNNER_SUITE
+
+public:
+    explicit QPrecompiledHeaderTest(QObject *parent = 0);
+    virtual ~QPrecompiledHeaderTest();
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void reuseTest();
+    void invalidationTest();
+
+private:
+    helpers::QTestProject* m_project;
+
+};
+
+#endif // QPRECOMPILEDHEADERTEST_HPP
@@ -85,4 +85,40 @@ QSharedPointer<csa::QCodeBase> createCodeBaseFromFile(const QString& filePath){
     return QSharedPointer<csa::QCodeBase>(new csa::QCodeBase(args, 3, QStringList() << filePath, ""));
 }
 
+QByteArray readFile(const QString& filePath){
+    QFile file(filePath);
+    if ( !file.open(QIODevice::ReadOnly) )
+        return QByteArray();
+    return file.readAll();
+}
+
+bool writeFile(const QString& filePath, const QByteArray& content){
+    QFile file(filePath);
+    if ( !file.open(QIODevice::WriteOnly) )
+        return false;
+    return file.write(content) == content.size();
+}
+
+QTestProject::QTestProject(){
+}
+
+bool QTestProject::isValid() const{
+    return m_dir.isValid();
+}
+
+QString QTestProject::path() const{
+    return m_dir.path();
+}
+
+QString QTestProject::filePath(const QString& name) const{
+    return m_dir.path() + "/" + name;
+}
+
+QString QTestProject::writeFile(const QString& name, const QByteArray& content) const{
+    QString path = filePath(name);
+    if ( !helpers::writeFile(path, content) )
+        return QString();
+    return path;
+}
+
 }
@@ -20,6 +20,7 @@
 
 #include <QJsonValue>
 #include <QSharedPointer>
+#include <QTemporaryDir>
 #include "QCodeBase.hpp"
 
 class QJSValue;
@@ -31,6 +32,24 @@ namespace helpers{
 
     QSharedPointer<csa::QCodeBase> createCodeBaseFromFile(const QString& filePath);
 
+    QByteArray readFile(const QString& filePath);
+    bool writeFile(const QString& filePath, const QByteArray& content);
+
+    // Temporary directory holding the source files of a test, removed together with the fixture
+    class QTestProject{
+
+    public:
+        QTestProject();
+
+        bool isValid() const;
+        QString path() const;
+        QString filePath(const QString& name) const;
+        QString writeFile(const QString& name, const QByteArray& content) const;
+
+    private:
+        QTemporaryDir m_dir;
+    };
+
 }// namespace
 
 #endif // QTESTHELPERS_HPP
@@ -0,0 +1,118 @@
+#include "QTranslationUnitCacheTest.hpp"
+#include "QTestHelpers.hpp"
+#include "QTranslationUnitCache.hpp"
+
+#include <QtTest/QtTest>
+
+using namespace csa;
+
+Q_TEST_RUNNER_REGISTER(QTranslationUnitCacheTest);
+
+QTranslationUnitCacheTest::QTranslationUnitCacheTest(QObject *parent)
+    : QObject(parent)
+    , m_project(0)
+{
+}
+
+QTranslationUnitCacheTest::~QTranslationUnitCacheTest(){
+    delete m_project;
+}
+
+void QTranslationUnitCacheTest::initTestCase(){
+}
+
+void QTranslationUnitCacheTest::init(){
+    m_project = new helpers::QTestProject;
+    QVERIFY(m_project->isValid());
+}
+
+void QTranslationUnitCacheTest::cleanup(){
+    delete m_project;
+    m_project = 0;
+}
+
+void QTranslationUnitCacheTest::roundTripTest(){
+    QString sourcePath = m_project->writeFile("source.cpp", "class S{};\n");
+    QVERIFY(!sourcePath.isEmpty());
+
+    const char* args[] = {"-c", "-x", "c++"};
+    QTranslationUnitCache cache(m_project->filePath("cache"));
+
+    CXIndex index = clang_createIndex(0, 0);
+    QDateTime parseStarted = QDateTime::currentDateTime();
+    CXTranslationUnit transUnit = clang_parseTranslationUnit(
+        index, sourcePath.toLocal8Bit().constData(), args, 3, 0, 0, CXTranslationUnit_None
+    );
+    QVERIFY(transUnit != 0);
+
+    // Nothing is loaded before the unit is saved
+    QVERIFY(cache.load(index, sourcePath, args, 3) == 0);
+    QVERIFY(cache.save(transUnit, sourcePath, args, 3, parseStarted));
+    clang_disposeTranslationUnit(transUnit);
+
+    CXTranslationUnit cachedUnit = cache.load(index, sourcePath, args, 3);
+    QVERIFY(cachedUnit != 0);
+
+    CXString spelling = clang_getTranslationUnitSpelling(cachedUnit);
+    QCOMPARE(QString(clang_getCString(spelling)), sourcePath);
+    clang_disposeString(spelling);
+    clang_disposeTranslationUnit(cachedUnit);
+
+    // Units are keyed by their arguments as well
+    const char* otherArgs[] = {"-c", "-x", "c++", "-DOTHER"};
+    QVERIFY(cache.load(index, sourcePath, otherArgs, 4) == 0);
+
+    clang_disposeIndex(index);
+}
+
+void QTranslationUnitCacheTest::changedDependencyTest(){
+    QString headerPath = m_project->writeFile("header.hpp", "class H{};\n");
+    QString sourcePath = m_project->writeFile("source.cpp", "#include \"header.hpp\"\nclass S{};\n");
+    QVERIFY(!headerPath.isEmpty() && !sourcePath.isEmpty());
+
+    const char* args[] = {"-c", "-x", "c++"};
+    QTranslationUnitCache cache(m_project->filePath("cache"));
+
+    CXIndex index = clang_createIndex(0, 0);
+    QDateTime parseStarted = QDateTime::currentDateTime();
+    CXTranslationUnit transUnit = clang_parseTranslationUnit(
+        index, sourcePath.toLocal8Bit().constData(), args, 3, 0, 0, CXTranslationUnit_None
+    );
+    QVERIFY(transUnit != 0);
+    QVERIFY(cache.save(transUnit, sourcePath, args, 3, parseStarted));
+    clang_disposeTranslationUnit(transUnit);
+
+    CXTranslationUnit cachedUnit = cache.load(index, sourcePath, args, 3);
+    QVERIFY(cachedUnit != 0);
+    clang_disposeTranslationUnit(cachedUnit);
+
+    // A changed header invalidates the units including it
+    QVERIFY(helpers::writeFile(headerPath, "class H{};\nclass I{};\n"));
+    QVERIFY(cache.load(index, sourcePath, args, 3) == 0);
+
+    clang_disposeIndex(index);
+}
+
+void QTranslationUnitCacheTest::changedDuringParseTest(){
+    QString headerPath = m_project->writeFile("header.hpp", "class H{};\n");
+    QString sourcePath = m_project->writeFile("source.cpp", "#include \"header.hpp\"\nclass S{};\n");
+    QVERIFY(!headerPath.isEmpty() && !sourcePath.isEmpty());
+
+    const char* args[] = {"-c", "-x", "c++"};
+    QTranslationUnitCache cache(m_project->filePath("cache"));
+
+    CXIndex index = clang_createIndex(0, 0);
+    CXTranslationUnit transUnit = clang_parseTranslationUnit(
+        index, sourcePath.toLocal8Bit().constData(), args, 3, 0, 0, CXTranslationUnit_None
+    );
+    QVERIFY(transUnit != 0);
+
+    // The header reads as written once the parse started, so the unit may hold either version and is not loaded back
+    QDateTime parseStarted = QFileInfo(headerPath).lastModified().addMSecs(-1);
+    QVERIFY(cache.save(transUnit, sourcePath, args, 3, parseStarted));
+    clang_disposeTranslationUnit(transUnit);
+
+    QVERIFY(cache.load(index, sourcePath, args, 3) == 0);
+
+    clang_disposeIndex(index);
+}
@@ -0,0 +1,33 @@
+#ifndef QTRANSLATIONUNITCACHETEST_HPP
+#define QTRANSLATIONUNITCACHETEST_HPP
+
+#include <QObject>
+#include "QTestRunner.hpp"
+
+namespace helpers{
+class QTestProject;
+}
+
+class QTranslationUnitCacheTest : public QObject{
+
+    Q_OBJECT
+    Q_TEST_RUNNER_SUITE
+
+public:
+    explicit QTranslationUnitCacheTest(QObject *parent = 0);
+    virtual ~QTranslationUnitCacheTest();
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void roundTripTest();
+    void changedDependencyTest();
+    void changedDuringParseTest();
+
+private:
+    helpers::QTestProject* m_project;
+
+};
+
+#endif // QTRANSLATIONUNITCACHETEST_HPP
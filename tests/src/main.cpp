@@ -21,6 +21,13 @@
 #include "QASTParsingTest.hpp"
 #include "QASTInsertionTest.hpp"
 #include "QASTSearchTest.hpp"
+#include "QASTNodeIndexTest.hpp"
+#include "QPieceTableTest.hpp"
+#include "QCodeBaseTest.hpp"
+#include "QTranslationUnitCacheTest.hpp"
+#include "QPrecompiledHeaderTest.hpp"
+#include "QCSANodeCollectionTest.hpp"
+#include "QCSAPluginLoaderTest.hpp"
 
 #include <qqml.h>
 #include "QCodeBase.hpp"
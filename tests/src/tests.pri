@@ -4,11 +4,25 @@ SOURCES += \
     $$PWD/QTestHelpers.cpp \
     $$PWD/QTestRunner.cpp \
     $$PWD/QASTInsertionTest.cpp \
-    $$PWD/QASTSearchTest.cpp
+    $$PWD/QASTSearchTest.cpp \
+    $$PWD/QASTNodeIndexTest.cpp \
+    $$PWD/QPieceTableTest.cpp \
+    $$PWD/QCodeBaseTest.cpp \
+    $$PWD/QTranslationUnitCacheTest.cpp \
+    $$PWD/QPrecompiledHeaderTest.cpp \
+    $$PWD/QCSANodeCollectionTest.cpp \
+    $$PWD/QCSAPluginLoaderTest.cpp
 
 HEADERS += \
     $$PWD/QASTParsingTest.hpp \
     $$PWD/QTestHelpers.hpp \
     $$PWD/QTestRunner.hpp \
     $$PWD/QASTInsertionTest.hpp \
-    $$PWD/QASTSearchTest.hpp
+    $$PWD/QASTSearchTest.hpp \
+    $$PWD/QASTNodeIndexTest.hpp \
+    $$PWD/QPieceTableTest.hpp \
+    $$PWD/QCodeBaseTest.hpp \
+    $$PWD/QTranslationUnitCacheTest.hpp \
+    $$PWD/QPrecompiledHeaderTest.hpp \
+    $$PWD/QCSANodeCollectionTest.hpp \
+    $$PWD/QCSAPluginLoaderTest.hpp